@@ -0,0 +1,148 @@
+/*
+ * Resumable sudoku solver.
+ */
+
+#include "board_solver.h"
+#include "profile.h"
+
+#define ALL_DIGITS 0x1FF
+
+static inline uint8_t box_of(uint8_t r, uint8_t c) {
+  return (r / 3) * 3 + c / 3;
+}
+
+static inline uint8_t count_bits(uint16_t m) {
+  uint8_t n = 0;
+  while (m) {
+    m &= m - 1;
+    n++;
+  }
+  return n;
+}
+
+static inline uint8_t digit_of(uint16_t bit) {
+  uint8_t d = 1;
+  while (bit >>= 1) {
+    d++;
+  }
+  return d;
+}
+
+static inline uint16_t candidates(const board_solver_t *s, uint8_t i) {
+  uint8_t r = i / 9, c = i % 9;
+  return ~(s->rows[r] | s->cols[c] | s->boxes[box_of(r, c)]) & ALL_DIGITS;
+}
+
+static inline void place(board_solver_t *s, uint8_t i, uint16_t bit) {
+  uint8_t r = i / 9, c = i % 9;
+  s->cells[i] = digit_of(bit);
+  s->rows[r] |= bit;
+  s->cols[c] |= bit;
+  s->boxes[box_of(r, c)] |= bit;
+}
+
+static inline void unplace(board_solver_t *s, uint8_t i) {
+  uint8_t r = i / 9, c = i % 9;
+  uint16_t bit = 1 << (s->cells[i] - 1);
+  s->cells[i] = 0;
+  s->rows[r] &= ~bit;
+  s->cols[c] &= ~bit;
+  s->boxes[box_of(r, c)] &= ~bit;
+}
+
+void board_solver_begin(board_solver_t *s, const uint8_t cells[81]) {
+  for (uint8_t i = 0; i < 9; i++) {
+    s->rows[i] = s->cols[i] = s->boxes[i] = 0;
+  }
+  s->depth = 0;
+  s->pick = true;
+  s->nodes = 0;
+  s->status = SOLVER_RUNNING;
+
+  for (uint8_t i = 0; i < 81; i++) {
+    s->cells[i] = 0;
+    uint8_t d = cells[i];
+    if (d == 0) {
+      continue;
+    }
+    if (d > 9) {
+      s->status = SOLVER_UNSOLVABLE; // not a digit
+      return;
+    }
+    uint16_t bit = 1 << (d - 1);
+    if (!(candidates(s, i) & bit)) {
+      s->status = SOLVER_UNSOLVABLE; // given clashes with another given
+      return;
+    }
+    place(s, i, bit);
+  }
+}
+
+solver_status_t board_solver_run(board_solver_t *s, uint16_t max_nodes) {
+  PROFILE_SECTION("board_solver_run");
+  while (s->status == SOLVER_RUNNING && max_nodes > 0) {
+    if (s->pick) {
+      // Branch on the empty cell with the fewest candidates
+      uint8_t best = 0xFF, best_count = 10;
+      uint16_t best_cand = 0;
+      for (uint8_t i = 0; i < 81 && best_count > 1; i++) {
+        if (s->cells[i] != 0) {
+          continue;
+        }
+        uint16_t cand = candidates(s, i);
+        uint8_t n = count_bits(cand);
+        if (n < best_count) {
+          best = i;
+          best_count = n;
+          best_cand = cand;
+          if (n == 0) {
+            break; // dead end, no need to look further
+          }
+        }
+      }
+      if (best == 0xFF) {
+        s->status = SOLVER_SOLVED;
+        break;
+      }
+      s->stack_cell[s->depth] = best;
+      s->stack_cand[s->depth] = best_cand;
+      s->pick = false;
+    }
+
+    uint16_t cand = s->stack_cand[s->depth];
+    if (cand == 0) {
+      // Nothing left to try here: undo the previous choice
+      if (s->depth == 0) {
+        s->status = SOLVER_UNSOLVABLE;
+        break;
+      }
+      s->depth--;
+      unplace(s, s->stack_cell[s->depth]);
+      continue;
+    }
+
+    uint16_t bit = cand & -cand;
+    s->stack_cand[s->depth] = cand & ~bit;
+    place(s, s->stack_cell[s->depth], bit);
+    s->depth++;
+    s->pick = true;
+    s->nodes++;
+    max_nodes--;
+  }
+  return (solver_status_t) s->status;
+}
+
+void board_solver_resume(board_solver_t *s) {
+  if (s->status != SOLVER_SOLVED) {
+    return;
+  }
+  if (s->depth == 0) {
+    s->status = SOLVER_UNSOLVABLE; // the givens filled the board
+    return;
+  }
+  // Undo the last choice; the candidates left at its depth come next
+  s->depth--;
+  unplace(s, s->stack_cell[s->depth]);
+  s->pick = false;
+  s->status = SOLVER_RUNNING;
+}
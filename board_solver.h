@@ -0,0 +1,51 @@
+/*
+ * Resumable sudoku solver.
+ *
+ * The solver does a depth first search, always branching on the empty
+ * cell with the fewest remaining candidates.  Candidates are kept as
+ * bitmasks per row, column and box, and the search stack is an array
+ * rather than recursion, so a search can be stopped after any number of
+ * nodes and picked up again later.  This lets the Arduino solve in short
+ * slices between drawing frames.
+ */
+
+#ifndef _BOARD_SOLVER_H
+#define _BOARD_SOLVER_H
+
+#include <stdint.h>
+
+typedef enum {
+  SOLVER_RUNNING,     // not finished yet, call board_solver_run() again
+  SOLVER_SOLVED,      // cells hold a complete solution
+  SOLVER_UNSOLVABLE   // the givens clash, or no way to fill the board exists
+} solver_status_t;
+
+typedef struct {
+  uint8_t cells[81];        // 0 for an empty cell, otherwise 1-9
+  uint16_t rows[9];         // bit d-1 set if digit d is used in the row
+  uint16_t cols[9];
+  uint16_t boxes[9];
+  uint8_t depth;            // number of cells filled in by the search
+  uint8_t stack_cell[81];   // cell filled at each depth
+  uint16_t stack_cand[81];  // candidates not yet tried at each depth
+  bool pick;                // next step chooses a new cell to branch on
+  uint8_t status;           // a solver_status_t
+  uint32_t nodes;           // cells filled in so far
+} board_solver_t;
+
+/* Starts solving a board given as 81 cells, row by row, 0 for empty. */
+void board_solver_begin(board_solver_t *s, const uint8_t cells[81]);
+
+/* Continues the search for at most max_nodes more cell assignments.
+ *
+ * Returns the solver status afterwards.
+ */
+solver_status_t board_solver_run(board_solver_t *s, uint16_t max_nodes);
+
+/* After SOLVER_SOLVED, moves the search on past the solution found, so
+ * that board_solver_run() looks for the next one, ending in
+ * SOLVER_UNSOLVABLE once there are no more.
+ */
+void board_solver_resume(board_solver_t *s);
+
+#endif
@@ -1,5 +1,6 @@
 #include "dprintf.h"
 #include <Arduino.h>
+#include "trace.h"
 
 #ifdef __DPRINTF_ENABLE
 /* only generate code if enabled */
@@ -30,6 +31,7 @@ void dprintf(const char* fmt, ... ) {
     if ( ! dprintf_enable ) {
         return;
         }
+    TRACE_SCOPE("dprintf");
 
     // varargs is the mechanism for handling ... arbitrary number of params.
     va_list args;
@@ -0,0 +1,86 @@
+/*
+ * Pre-rendered digit tiles for drawing sudoku cells to the LCD display.
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <avr/pgmspace.h>
+
+#include "glyph_tiles.h"
+#include "profile.h"
+
+/* One bit per pixel, bit x of row y set where the digit is drawn.  The
+ * digits are the 5x7 Adafruit_GFX font characters placed 2 pixels in from
+ * the top left corner, so they land where tft.print() used to put them.
+ */
+static const uint16_t glyph_rows[10][GLYPH_SIZE] PROGMEM = {
+  { 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000 }, // blank
+  { 0x000, 0x000, 0x010, 0x018, 0x010, 0x010, 0x010, 0x010, 0x038, 0x000 }, // 1
+  { 0x000, 0x000, 0x038, 0x044, 0x040, 0x020, 0x010, 0x008, 0x07C, 0x000 }, // 2
+  { 0x000, 0x000, 0x07C, 0x020, 0x010, 0x020, 0x040, 0x044, 0x038, 0x000 }, // 3
+  { 0x000, 0x000, 0x020, 0x030, 0x028, 0x024, 0x07C, 0x020, 0x020, 0x000 }, // 4
+  { 0x000, 0x000, 0x07C, 0x004, 0x03C, 0x040, 0x040, 0x044, 0x038, 0x000 }, // 5
+  { 0x000, 0x000, 0x030, 0x008, 0x004, 0x03C, 0x044, 0x044, 0x038, 0x000 }, // 6
+  { 0x000, 0x000, 0x07C, 0x040, 0x020, 0x010, 0x008, 0x008, 0x008, 0x000 }, // 7
+  { 0x000, 0x000, 0x038, 0x044, 0x044, 0x038, 0x044, 0x044, 0x038, 0x000 }, // 8
+  { 0x000, 0x000, 0x038, 0x044, 0x044, 0x078, 0x040, 0x020, 0x018, 0x000 }, // 9
+};
+
+// Foreground and background colour of each style.
+static const uint16_t glyph_colours[GLYPH_NSTYLES][2] = {
+  { ST7735_BLACK, ST7735_WHITE }, // GLYPH_GIVEN
+  { ST7735_RED,   ST7735_WHITE }, // GLYPH_USER
+  { ST7735_WHITE, ST7735_BLUE  }, // GLYPH_SELECTED
+  { ST7735_WHITE, ST7735_RED   }, // GLYPH_CONFLICT
+};
+
+static uint8_t glyph_cs;
+static uint8_t glyph_dc;
+
+void glyph_init(uint8_t cs_pin, uint8_t dc_pin) {
+  glyph_cs = cs_pin;
+  glyph_dc = dc_pin;
+}
+
+void glyph_draw(Adafruit_ST7735 *tft, uint8_t digit, glyph_style_t style,
+                uint16_t x, uint16_t y)
+{
+  PROFILE_SECTION("glyph_draw");
+  if (digit > 9) {
+    digit = 0;
+  }
+
+  uint8_t fg_hi = glyph_colours[style][0] >> 8;
+  uint8_t fg_lo = glyph_colours[style][0];
+  uint8_t bg_hi = glyph_colours[style][1] >> 8;
+  uint8_t bg_lo = glyph_colours[style][1];
+
+  // Setup display to receive window of pixels
+  tft->setAddrWindow(x, y, x + GLYPH_SIZE - 1, y + GLYPH_SIZE - 1);
+
+  // Stream the whole tile with the display selected once, rather than
+  // toggling chip select around every pixel like pushColor() does.
+  digitalWrite(glyph_dc, HIGH);
+  digitalWrite(glyph_cs, LOW);
+  for (uint8_t row = 0; row < GLYPH_SIZE; row++) {
+    uint16_t bits = pgm_read_word(&glyph_rows[digit][row]);
+    for (uint8_t col = 0; col < GLYPH_SIZE; col++) {
+      if (bits & 1) {
+        SPI.transfer(fg_hi);
+        SPI.transfer(fg_lo);
+      } else {
+        SPI.transfer(bg_hi);
+        SPI.transfer(bg_lo);
+      }
+      bits >>= 1;
+    }
+  }
+  digitalWrite(glyph_cs, HIGH);
+}
+
+void glyph_draw_cell(Adafruit_ST7735 *tft, uint8_t row, uint8_t col,
+                     uint8_t digit, glyph_style_t style)
+{
+  glyph_draw(tft, digit, style,
+             col * GLYPH_PITCH + GLYPH_OFFSET, row * GLYPH_PITCH + GLYPH_OFFSET);
+}
@@ -0,0 +1,57 @@
+/*
+ * Pre-rendered digit tiles for drawing sudoku cells to the LCD display.
+ *
+ * Each digit 1-9 (and 0 for a blank cell) is stored as a 10x10 one bit
+ * tile in flash.  A tile is drawn by opening one address window covering
+ * the inside of a board cell and streaming all of its pixels in a single
+ * SPI burst, instead of going through Adafruit_GFX text drawing which
+ * opens a new window for every pixel of the character.
+ */
+
+#ifndef _GLYPH_TILES_H
+#define _GLYPH_TILES_H
+
+#include <Adafruit_GFX.h>    // Core graphics library
+#include <Adafruit_ST7735.h> // Hardware-specific library
+
+// Width and height of a tile in pixels.  This is the largest square that
+// fits inside every cell of the background board image.
+#define GLYPH_SIZE 10
+
+// Distance in pixels between the top left corners of neighbouring cells,
+// and the offset of a tile from the corner of its cell.
+#define GLYPH_PITCH 14
+#define GLYPH_OFFSET 3
+
+// Colour schemes a cell can be drawn with.
+typedef enum {
+  GLYPH_GIVEN,     // hint from the server: black on white
+  GLYPH_USER,      // entered by the player: red on white
+  GLYPH_SELECTED,  // cell under the cursor
+  GLYPH_CONFLICT,  // value clashes with another cell in its row/col/box
+  GLYPH_NSTYLES
+} glyph_style_t;
+
+/* Sets the pins used to stream pixels to the display.  These must be the
+ * same chip select and data/command lines the tft was constructed with.
+ */
+void glyph_init(uint8_t cs_pin, uint8_t dc_pin);
+
+/* Draws one digit tile.
+ *
+ * tft    : the initialized tft struct
+ * digit  : 1-9, or 0 to clear the tile to the style's background
+ * style  : colour scheme to draw with
+ * x, y   : upper-left corner of the tile on the screen
+ */
+void glyph_draw(Adafruit_ST7735 *tft, uint8_t digit, glyph_style_t style,
+                uint16_t x, uint16_t y);
+
+/* Draws the tile for a board cell.
+ *
+ * row, col : the cell on the board, 0-8
+ */
+void glyph_draw_cell(Adafruit_ST7735 *tft, uint8_t row, uint8_t col,
+                     uint8_t digit, glyph_style_t style);
+
+#endif
@@ -0,0 +1,845 @@
+/*
+ * Host core: clock, pins, scripted input, timer callbacks, Serial, SPI
+ * and EEPROM.  See host.h for how a run is configured.
+ */
+
+#define _GNU_SOURCE 1
+#include <Arduino.h>
+#include <SPI.h>
+#include <Adafruit_ST7735.h>
+#include <avr/eeprom.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "host_core.h"
+
+#define HOST_NPINS 70
+#define HOST_MAX_TIMERS 8
+#define HOST_MAX_SPI 4
+#define HOST_TX_BUFFER 64  // size of the Mega's serial transmit buffer
+// Once the script is used up, how long to let its last input show on the
+// screen before the run stops, and how long at most to wait for it
+#define HOST_SCRIPT_SETTLE_NS 1000000000ULL
+#define HOST_SCRIPT_WAIT_NS 10000000000ULL
+
+static bool started = false;
+
+// Clock
+static bool virtual_clock = false;
+static uint64_t virtual_ns = 0;
+static struct timespec epoch;
+
+// Timer callbacks
+static struct {
+  void (*fn)();
+  uint64_t period_ns;
+  uint64_t next_ns;
+} timers[HOST_MAX_TIMERS];
+static uint8_t ntimers = 0;
+static bool in_callback = false;
+
+// Pins, and the scripted changes to them
+static uint16_t pins[HOST_NPINS];
+typedef struct {
+  uint64_t at_ns;
+  int16_t pin;  // -1 marks the end of the run
+  uint16_t value;
+} pin_change_t;
+static pin_change_t *script = NULL;
+static size_t script_len = 0;
+static size_t script_next = 0;
+static uint64_t exit_ns = 0;
+
+// Lines the server sent in a recorded session, received again at the same
+// times, and when the script last changed anything
+typedef struct {
+  uint64_t at_ns;
+  char *text;  // with its newline
+} script_line_t;
+static script_line_t *script_lines = NULL;
+static size_t script_nlines = 0;
+static size_t script_next_line = 0;
+static bool sent_since_line = false;  // the sketch wrote to Serial since the last one
+static uint64_t script_last_ns = 0;
+
+// Input to pixel latency: the latest pin change, the event waiting for
+// the screen to change, and the latencies seen so far
+static FILE *latency_file = NULL;
+static uint64_t last_change_ns = 0;
+static struct {
+  const char *name;  // NULL when nothing is waiting
+  uint64_t input_ns, event_ns;
+} latency_pending;
+static uint64_t *latencies = NULL;
+static size_t nlatencies = 0;
+static size_t latency_cap = 0;
+static size_t latency_missed = 0;  // events that changed nothing
+
+// Serial
+static int serial_in = -1;
+static int serial_out = -1;
+static unsigned long serial_baud = 9600;
+static uint64_t tx_idle_ns = 0;  // when the transmit buffer drains
+static uint8_t rx_buf[1024];
+static size_t rx_len = 0;
+static size_t rx_pos = 0;
+
+// SPI
+static uint8_t spi_divider = 4;
+static uint64_t spi_count = 0;
+static struct {
+  uint8_t cs, dc;
+  HostSPIDevice *dev;
+} spi_devices[HOST_MAX_SPI];
+static uint8_t nspi = 0;
+
+// EEPROM
+static uint8_t eeprom[E2END + 1];
+static int eeprom_fd = -1;
+static uint64_t eeprom_busy_ns = 0;
+
+HardwareSerial Serial;
+SPIClass SPI;
+
+/* Clock */
+
+static uint64_t wall_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) (now.tv_sec - epoch.tv_sec) * 1000000000ULL
+    + now.tv_nsec - epoch.tv_nsec;
+}
+
+uint64_t host_now_ns() {
+  return virtual_clock ? virtual_ns : wall_ns();
+}
+
+void host_spend_ns(uint64_t ns) {
+  if (virtual_clock) {
+    virtual_ns += ns;
+  }
+}
+
+/* Waits until the host clock reaches ns. */
+static void wait_until(uint64_t ns) {
+  if (virtual_clock) {
+    if (ns > virtual_ns) {
+      virtual_ns = ns;
+    }
+    return;
+  }
+  uint64_t now = wall_ns();
+  if (ns > now) {
+    struct timespec d = {
+      (time_t) ((ns - now) / 1000000000ULL), (long) ((ns - now) % 1000000000ULL)
+    };
+    nanosleep(&d, NULL);
+  }
+}
+
+/* Scripted input */
+
+static int parse_pin(const char *s) {
+  if (s[0] == 'A') {
+    return A0 + atoi(s + 1);
+  }
+  return atoi(s);
+}
+
+static void load_script(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    fprintf(stderr, "host: cannot open HOST_INPUT %s: %s\n", path, strerror(errno));
+    exit(1);
+  }
+  size_t cap = 0, lines_cap = 0;
+  char line[256];
+  unsigned lineno = 0;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    lineno++;
+    char *hash = strchr(line, '#');
+    if (hash != NULL) {
+      *hash = '\0';
+    }
+    char pin[16];
+    double ms;
+    int value = 0;
+    int text_at = 0;
+    if (sscanf(line, "%lf serial %n", &ms, &text_at) == 1 && text_at > 0) {
+      char *text = line + text_at;
+      text[strcspn(text, "\r\n")] = '\0';
+      if (script_nlines == lines_cap) {
+        lines_cap = lines_cap ? 2 * lines_cap : 64;
+        script_lines = (script_line_t *) realloc(script_lines, lines_cap * sizeof(*script_lines));
+      }
+      script_lines[script_nlines].at_ns = (uint64_t) (ms * 1e6);
+      script_lines[script_nlines].text = (char *) malloc(strlen(text) + 2);
+      sprintf(script_lines[script_nlines].text, "%s\n", text);
+      script_nlines++;
+      continue;
+    }
+    int n = sscanf(line, "%lf %15s %d", &ms, pin, &value);
+    if (n <= 0) {
+      continue;  // blank line
+    }
+    bool end = (n == 2 && strcmp(pin, "end") == 0);
+    if (!end && n != 3) {
+      fprintf(stderr, "host: %s:%u: expected '<millis> <pin> <value>'\n", path, lineno);
+      exit(1);
+    }
+    if (script_len == cap) {
+      cap = cap ? 2 * cap : 64;
+      script = (pin_change_t *) realloc(script, cap * sizeof(*script));
+    }
+    script[script_len].at_ns = (uint64_t) (ms * 1e6);
+    script[script_len].pin = end ? -1 : parse_pin(pin);
+    script[script_len].value = value;
+    script_len++;
+  }
+  fclose(f);
+}
+
+static void run_script() {
+  uint64_t now = host_now_ns();
+  while (script_next < script_len && script[script_next].at_ns <= now) {
+    pin_change_t *c = &script[script_next++];
+    if (c->pin < 0) {
+      host_exit(0);
+    }
+    host_set_pin(c->pin, c->value);
+    last_change_ns = script_last_ns = c->at_ns;
+  }
+  // A server line waits for its time, and for the sketch to have sent
+  // something since the last one: however much sooner the sketch gets
+  // there than it did when recorded, an answer never comes before the
+  // request it answers.
+  while (script_next_line < script_nlines && script_lines[script_next_line].at_ns <= now
+         && sent_since_line) {
+    const char *text = script_lines[script_next_line++].text;
+    host_serial_feed(text, strlen(text));
+    sent_since_line = false;
+    script_last_ns = now;
+  }
+  if (exit_ns != 0 && now >= exit_ns) {
+    host_exit(0);
+  }
+  // A script without an end line stops once its last input has had its
+  // effect on the screen
+  if (script_len + script_nlines > 0 && script_next == script_len
+      && script_next_line == script_nlines) {
+    uint64_t since = now - script_last_ns;
+    if ((since >= HOST_SCRIPT_SETTLE_NS && latency_pending.name == NULL)
+        || since >= HOST_SCRIPT_WAIT_NS) {
+      host_exit(0);
+    }
+  }
+}
+
+/* Input to pixel latency */
+
+static void latency_close(bool changed) {
+  if (latency_pending.name == NULL) {
+    return;
+  }
+  uint64_t now = host_now_ns();
+  fprintf(latency_file, "%s,%.3f,%.3f,", latency_pending.name,
+          latency_pending.input_ns / 1e6, latency_pending.event_ns / 1e6);
+  if (changed) {
+    if (nlatencies == latency_cap) {
+      latency_cap = latency_cap ? 2 * latency_cap : 64;
+      latencies = (uint64_t *) realloc(latencies, latency_cap * sizeof(*latencies));
+    }
+    latencies[nlatencies++] = now - latency_pending.input_ns;
+    fprintf(latency_file, "%.3f,%.3f\n", now / 1e6, (now - latency_pending.input_ns) / 1e6);
+  } else {
+    latency_missed++;
+    fprintf(latency_file, ",\n");
+  }
+  latency_pending.name = NULL;
+}
+
+void host_input_event(const char *name) {
+  if (latency_file == NULL) {
+    return;
+  }
+  latency_close(false);  // the one before never changed the screen
+  latency_pending.name = name;
+  latency_pending.input_ns = last_change_ns;
+  latency_pending.event_ns = host_now_ns();
+}
+
+void host_pixel_changed() {
+  latency_close(true);
+}
+
+static int compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+  return x < y ? -1 : x > y;
+}
+
+static void latency_summary() {
+  if (latency_file == NULL) {
+    return;
+  }
+  latency_close(false);
+  if (nlatencies == 0 && latency_missed == 0) {
+    return;
+  }
+  qsort(latencies, nlatencies, sizeof(*latencies), compare_u64);
+  fprintf(stderr, "host: %zu input events, %zu changed nothing on screen\n",
+          nlatencies + latency_missed, latency_missed);
+  if (nlatencies > 0) {
+    fprintf(stderr, "host: input to pixel ms: p50 %.3f p95 %.3f max %.3f\n",
+            latencies[(nlatencies - 1) / 2] / 1e6,
+            latencies[(nlatencies * 95 + 99) / 100 - 1] / 1e6,
+            latencies[nlatencies - 1] / 1e6);
+  }
+}
+
+/* Serial set up */
+
+static void make_raw(int fd) {
+  struct termios t;
+  if (tcgetattr(fd, &t) == 0) {
+    cfmakeraw(&t);
+    tcsetattr(fd, TCSANOW, &t);
+  }
+}
+
+static void open_serial(const char *spec) {
+  if (strcmp(spec, "none") == 0) {
+    return;
+  }
+  if (strcmp(spec, "stdio") == 0) {
+    host_serial_attach(0, 1);
+    return;
+  }
+  if (strncmp(spec, "fd:", 3) == 0) {
+    int in, out;
+    if (sscanf(spec + 3, "%d,%d", &in, &out) != 2) {
+      fprintf(stderr, "host: HOST_SERIAL=fd: wants two numbers, fd:IN,OUT\n");
+      exit(1);
+    }
+    host_serial_attach(in, out);
+    return;
+  }
+  if (strcmp(spec, "pty") == 0) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+      perror("host: pty");
+      exit(1);
+    }
+    // Hold the slave end open, in raw mode, so nothing is echoed back and
+    // reads do not fail while the server is not attached yet.
+    const char *slave_name = ptsname(master);
+    int slave = open(slave_name, O_RDWR | O_NOCTTY);
+    if (slave >= 0) {
+      make_raw(slave);
+    }
+    make_raw(master);
+    fprintf(stderr, "host: serial port is %s\n", slave_name);
+    host_serial_attach(master, master);
+    return;
+  }
+  int fd = open(spec, O_RDWR | O_NOCTTY);
+  if (fd < 0) {
+    fprintf(stderr, "host: cannot open HOST_SERIAL %s: %s\n", spec, strerror(errno));
+    exit(1);
+  }
+  make_raw(fd);
+  host_serial_attach(fd, fd);
+}
+
+void host_serial_attach(int in_fd, int out_fd) {
+  serial_in = in_fd;
+  serial_out = out_fd;
+  if (in_fd >= 0) {
+    fcntl(in_fd, F_SETFL, fcntl(in_fd, F_GETFL) | O_NONBLOCK);
+  }
+  rx_len = rx_pos = 0;
+}
+
+/* EEPROM set up */
+
+static void open_eeprom(const char *path) {
+  memset(eeprom, 0xFF, sizeof(eeprom));  // erased, like a new part
+  if (path == NULL) {
+    return;
+  }
+  eeprom_fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (eeprom_fd < 0) {
+    fprintf(stderr, "host: cannot open HOST_EEPROM %s: %s\n", path, strerror(errno));
+    exit(1);
+  }
+  ssize_t n = pread(eeprom_fd, eeprom, sizeof(eeprom), 0);
+  if (n < (ssize_t) sizeof(eeprom)) {
+    memset(eeprom + (n > 0 ? n : 0), 0xFF, sizeof(eeprom) - (n > 0 ? n : 0));
+  }
+}
+
+/* Start up */
+
+static void host_start() {
+  if (started) {
+    return;
+  }
+  started = true;
+  clock_gettime(CLOCK_MONOTONIC, &epoch);
+  signal(SIGPIPE, SIG_IGN);  // a server going away is not our end
+
+  for (int i = 0; i < HOST_NPINS; i++) {
+    pins[i] = i >= A0 ? 512 : HIGH;  // centred joystick, released buttons
+  }
+
+  const char *clock = getenv("HOST_CLOCK");
+  if (clock != NULL && strcmp(clock, "virtual") == 0) {
+    virtual_clock = true;
+  } else if (clock != NULL && strcmp(clock, "real") != 0) {
+    fprintf(stderr, "host: HOST_CLOCK is real or virtual, not %s\n", clock);
+    exit(1);
+  }
+
+  const char *serial = getenv("HOST_SERIAL");
+  open_serial(serial != NULL ? serial : "pty");
+
+  const char *input = getenv("HOST_INPUT");
+  if (input != NULL) {
+    load_script(input);
+  }
+  const char *exit_ms = getenv("HOST_EXIT_MS");
+  if (exit_ms != NULL) {
+    exit_ns = (uint64_t) (atof(exit_ms) * 1e6);
+  }
+  open_eeprom(getenv("HOST_EEPROM"));
+
+  const char *latency = getenv("HOST_LATENCY");
+  if (latency != NULL) {
+    latency_file = fopen(latency, "w");
+    if (latency_file == NULL) {
+      fprintf(stderr, "host: cannot write HOST_LATENCY %s: %s\n", latency, strerror(errno));
+      exit(1);
+    }
+    fprintf(latency_file, "event,input_ms,event_ms,pixel_ms,latency_ms\n");
+  }
+}
+
+void host_call() {
+  host_start();
+  host_spend_ns(HOST_CALL_NS);
+  if (in_callback) {
+    return;
+  }
+  in_callback = true;
+  run_script();
+  uint64_t now = host_now_ns();
+  for (uint8_t i = 0; i < ntimers; i++) {
+    while (timers[i].next_ns <= now) {
+      timers[i].next_ns += timers[i].period_ns;
+      timers[i].fn();
+    }
+  }
+  in_callback = false;
+}
+
+/* Writes the panel to path as a binary PPM. */
+static void write_ppm(const char *path, const uint16_t *fb) {
+  FILE *f = fopen(path, "wb");
+  if (f == NULL) {
+    fprintf(stderr, "host: cannot write HOST_PPM %s: %s\n", path, strerror(errno));
+    return;
+  }
+  fprintf(f, "P6\n%d %d\n255\n", ST7735_TFTWIDTH, ST7735_TFTHEIGHT);
+  for (int i = 0; i < ST7735_TFTWIDTH * ST7735_TFTHEIGHT; i++) {
+    uint16_t c = fb[i];
+    uint8_t rgb[3] = {
+      (uint8_t) (((c >> 11) & 0x1F) * 255 / 31),
+      (uint8_t) (((c >> 5) & 0x3F) * 255 / 63),
+      (uint8_t) ((c & 0x1F) * 255 / 31)
+    };
+    fwrite(rgb, 1, 3, f);
+  }
+  fclose(f);
+}
+
+void host_exit(int status) {
+  const char *ppm = getenv("HOST_PPM");
+  if (ppm != NULL && host_tft != NULL) {
+    write_ppm(ppm, host_tft->pixels());
+  }
+  if (eeprom_fd >= 0) {
+    fsync(eeprom_fd);
+  }
+  latency_summary();
+  if (latency_file != NULL) {
+    fclose(latency_file);
+  }
+  fprintf(stderr, "host: stopped at %.3f ms\n", host_now_ns() / 1e6);
+  exit(status);
+}
+
+void host_every(unsigned long period_us, void (*fn)()) {
+  host_start();
+  if (ntimers == HOST_MAX_TIMERS) {
+    fprintf(stderr, "host: too many timer callbacks\n");
+    exit(1);
+  }
+  timers[ntimers].fn = fn;
+  timers[ntimers].period_ns = (uint64_t) period_us * 1000;
+  timers[ntimers].next_ns = host_now_ns() + timers[ntimers].period_ns;
+  ntimers++;
+}
+
+void init() {
+  host_start();
+}
+
+/* Time */
+
+unsigned long millis() {
+  host_call();
+  return host_now_ns() / 1000000;
+}
+
+unsigned long micros() {
+  host_call();
+  return host_now_ns() / 1000;
+}
+
+void delay(unsigned long ms) {
+  host_call();
+  uint64_t until = host_now_ns() + (uint64_t) ms * 1000000;
+  // Step through the wait so timer callbacks and the script keep running
+  while (host_now_ns() < until) {
+    uint64_t step = until - host_now_ns();
+    if (step > 1000000) {
+      step = 1000000;
+    }
+    wait_until(host_now_ns() + step);
+    host_call();
+  }
+}
+
+void delayMicroseconds(unsigned int us) {
+  host_call();
+  wait_until(host_now_ns() + (uint64_t) us * 1000);
+}
+
+/* Pins */
+
+void host_set_pin(uint8_t pin, int value) {
+  if (pin < HOST_NPINS) {
+    pins[pin] = value;
+  }
+}
+
+void host_pin_write(uint8_t pin, uint8_t value) {
+  if (pin < HOST_NPINS) {
+    pins[pin] = value;
+  }
+}
+
+uint8_t host_pin_read(uint8_t pin) {
+  return pin < HOST_NPINS ? pins[pin] != 0 : LOW;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  host_call();
+  if (mode == INPUT_PULLUP) {
+    host_pin_write(pin, HIGH);
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  host_call();
+  host_pin_write(pin, val);
+}
+
+int digitalRead(uint8_t pin) {
+  host_call();
+  return host_pin_read(pin);
+}
+
+int analogRead(uint8_t pin) {
+  host_call();
+  if (pin < A0) {
+    pin += A0;  // channel numbers work as well as pin numbers
+  }
+  host_spend_ns(HOST_ANALOG_READ_NS);
+  return pin < HOST_NPINS ? pins[pin] & 0x3FF : 0;
+}
+
+/* Odds and ends */
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+long random(long howbig) {
+  host_call();
+  return howbig <= 0 ? 0 : ::random() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+  return howsmall >= howbig ? howsmall : random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) {
+    srandom(seed);
+  }
+}
+
+/* Print */
+
+size_t Print::write(const uint8_t *buf, size_t size) {
+  size_t n = 0;
+  while (size-- > 0) {
+    n += write(*buf++);
+  }
+  return n;
+}
+
+size_t Print::print(long n, int base) {
+  if (n < 0 && base == DEC) {
+    return print('-') + print((unsigned long) -n, base);
+  }
+  return print((unsigned long) n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+  char buf[8 * sizeof(long) + 1];
+  char *s = &buf[sizeof(buf) - 1];
+  *s = '\0';
+  if (base < 2) {
+    base = 10;
+  }
+  do {
+    unsigned long digit = n % base;
+    *--s = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    n /= base;
+  } while (n != 0);
+  return write(s);
+}
+
+size_t Print::print(double n, int digits) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return write(buf);
+}
+
+/* Serial */
+
+/* Time one character takes on the wire: start bit, 8 data bits, stop bit. */
+static uint64_t serial_char_ns() {
+  return 10000000000ULL / serial_baud;
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+  host_call();
+  serial_baud = baud;
+}
+
+void HardwareSerial::end() {
+  flush();
+}
+
+static void fill_rx() {
+  if (serial_in < 0 || rx_len == sizeof(rx_buf)) {
+    return;
+  }
+  if (rx_pos == rx_len) {
+    rx_pos = rx_len = 0;
+  }
+  ssize_t n = read(serial_in, rx_buf + rx_len, sizeof(rx_buf) - rx_len);
+  if (n > 0) {
+    rx_len += n;
+  }
+}
+
+void host_serial_feed(const void *bytes, size_t n) {
+  host_start();
+  if (rx_pos > 0) {
+    memmove(rx_buf, rx_buf + rx_pos, rx_len - rx_pos);
+    rx_len -= rx_pos;
+    rx_pos = 0;
+  }
+  if (n > sizeof(rx_buf) - rx_len) {
+    n = sizeof(rx_buf) - rx_len;  // overrun, like the real receive buffer
+  }
+  memcpy(rx_buf + rx_len, bytes, n);
+  rx_len += n;
+}
+
+int HardwareSerial::available() {
+  host_call();
+  fill_rx();
+  if (rx_pos == rx_len && virtual_clock && serial_in >= 0) {
+    // Nothing yet.  Whoever is on the other end runs on the wall clock,
+    // so wait for them a little, and let the virtual clock follow.
+    struct pollfd p = { serial_in, POLLIN, 0 };
+    uint64_t before = wall_ns();
+    poll(&p, 1, 1);
+    virtual_ns += wall_ns() - before;
+    fill_rx();
+  }
+  return rx_len - rx_pos;
+}
+
+int HardwareSerial::peek() {
+  return available() > 0 ? rx_buf[rx_pos] : -1;
+}
+
+int HardwareSerial::read() {
+  return available() > 0 ? rx_buf[rx_pos++] : -1;
+}
+
+void HardwareSerial::flush() {
+  host_call();
+  wait_until(tx_idle_ns);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t size) {
+  host_call();
+  sent_since_line = true;
+  for (size_t i = 0; i < size; i++) {
+    // Queue each character behind the ones still going out, waiting for
+    // room when the transmit buffer is full, as the real one does.
+    uint64_t now = host_now_ns();
+    uint64_t full_ns = HOST_TX_BUFFER * serial_char_ns();
+    if (tx_idle_ns > now + full_ns) {
+      wait_until(tx_idle_ns - full_ns);
+      now = host_now_ns();
+    }
+    tx_idle_ns = (tx_idle_ns > now ? tx_idle_ns : now) + serial_char_ns();
+  }
+  if (serial_out >= 0) {
+    size_t done = 0;
+    while (done < size) {
+      ssize_t n = ::write(serial_out, buf + done, size - done);
+      if (n < 0 && errno == EAGAIN) {
+        struct pollfd p = { serial_out, POLLOUT, 0 };
+        poll(&p, 1, 100);
+        continue;
+      }
+      if (n <= 0) {
+        break;
+      }
+      done += n;
+    }
+  }
+  return size;
+}
+
+/* SPI */
+
+void SPIClass::begin() {
+  host_call();
+}
+
+void SPIClass::end() {
+}
+
+void SPIClass::setClockDivider(uint8_t div) {
+  static const uint8_t dividers[] = { 4, 16, 64, 128, 2, 8, 32, 64 };
+  host_spi_set_divider(dividers[div & 7]);
+}
+
+void SPIClass::setDataMode(uint8_t) {
+}
+
+void SPIClass::setBitOrder(uint8_t) {
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  host_start();
+  host_spend_ns(host_spi_byte_ns());
+  spi_count++;
+  for (uint8_t i = 0; i < nspi; i++) {
+    if (host_pin_read(spi_devices[i].cs) == LOW) {
+      bool command = spi_devices[i].dc != 0xFF
+        && host_pin_read(spi_devices[i].dc) == LOW;
+      spi_devices[i].dev->spi_byte(data, command);
+    }
+  }
+  return 0xFF;
+}
+
+void host_spi_attach(uint8_t cs_pin, uint8_t dc_pin, HostSPIDevice *dev) {
+  for (uint8_t i = 0; i < nspi; i++) {
+    if (spi_devices[i].cs == cs_pin) {
+      spi_devices[i].dc = dc_pin;
+      spi_devices[i].dev = dev;
+      return;
+    }
+  }
+  if (nspi == HOST_MAX_SPI) {
+    fprintf(stderr, "host: too many SPI devices\n");
+    exit(1);
+  }
+  spi_devices[nspi].cs = cs_pin;
+  spi_devices[nspi].dc = dc_pin;
+  spi_devices[nspi].dev = dev;
+  nspi++;
+}
+
+uint64_t host_spi_byte_ns() {
+  // 8 clocks at F_CPU / divider, and a couple of cycles to load SPDR and
+  // poll SPIF between bytes
+  return (8ULL * spi_divider + 4) * 1000000000ULL / F_CPU;
+}
+
+uint64_t host_spi_bytes() {
+  return spi_count;
+}
+
+void host_spi_set_divider(uint8_t div) {
+  spi_divider = div;
+}
+
+/* EEPROM */
+
+uint8_t eeprom_read_byte(const uint8_t *addr) {
+  host_call();
+  wait_until(eeprom_busy_ns);
+  return eeprom[(uintptr_t) addr & E2END];
+}
+
+void eeprom_read_block(void *dst, const void *src, size_t n) {
+  host_call();
+  wait_until(eeprom_busy_ns);
+  for (size_t i = 0; i < n; i++) {
+    ((uint8_t *) dst)[i] = eeprom[((uintptr_t) src + i) & E2END];
+  }
+}
+
+void eeprom_write_byte(uint8_t *addr, uint8_t value) {
+  host_call();
+  wait_until(eeprom_busy_ns);
+  uintptr_t a = (uintptr_t) addr & E2END;
+  eeprom[a] = value;
+  if (eeprom_fd >= 0) {
+    pwrite(eeprom_fd, &value, 1, a);
+  }
+  eeprom_busy_ns = host_now_ns() + HOST_EEPROM_WRITE_NS;
+}
+
+void eeprom_update_byte(uint8_t *addr, uint8_t value) {
+  if (eeprom_read_byte(addr) != value) {
+    eeprom_write_byte(addr, value);
+  }
+}
+
+bool eeprom_is_ready() {
+  host_call();
+  return host_now_ns() >= eeprom_busy_ns;
+}
@@ -0,0 +1,388 @@
+/*
+ * Microbenchmarks of the client modules, run on the host build.
+ *
+ *   make -C host bench && host/bench [--json] [filter]
+ *
+ * Each benchmark is timed over enough iterations to take about
+ * BENCH_TARGET_NS (and at least BENCH_MIN_ITERATIONS), and the fastest of
+ * BENCH_REPEATS such runs is kept.
+ * Results go to stdout as CSV (or JSON with --json), one row per
+ * benchmark:
+ *
+ *   name            benchmark name
+ *   iterations      operations in each timed run
+ *   ns_per_op       host time per operation
+ *   allocs_per_op   heap allocations per operation
+ *   bytes_per_op    heap bytes allocated per operation
+ *   spi_per_op      bytes sent to the display per operation
+ *   device_ns_per_op  time per operation on the Arduino, as modelled by
+ *                   the virtual clock; empty for pure computation, which
+ *                   the host does not model
+ *
+ * Only names containing filter are run.
+ */
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_ST7735.h>
+#include <SD.h>
+
+#include <time.h>
+
+#include "host_core.h"
+#include "hashtable.h"
+#include "lcd_image.h"
+#include "dprintf.h"
+#include "serial_handling.h"
+#include "board_solver.h"
+
+#define BENCH_TARGET_NS 200000000ULL
+#define BENCH_REPEATS 5
+#define BENCH_MIN_ITERATIONS 100
+#define BENCH_CALIBRATIONS 4  // passes checking the iteration count at most
+
+/* Allocation counting.  Sketch objects reach malloc() directly (the
+ * link wraps it) and HashTable's items come through operator new.
+ */
+static uint64_t alloc_count = 0;
+static uint64_t alloc_bytes = 0;
+
+extern "C" void *__real_malloc(size_t size);
+extern "C" void *__wrap_malloc(size_t size) {
+  alloc_count++;
+  alloc_bytes += size;
+  return __real_malloc(size);
+}
+
+void *operator new(size_t size) {
+  alloc_count++;
+  alloc_bytes += size;
+  return __real_malloc(size);
+}
+
+void operator delete(void *p) noexcept {
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  free(p);
+}
+
+/* Benchmarks */
+
+typedef struct {
+  const char *name;
+  void (*setup)();
+  void (*op)();
+  void (*teardown)();
+  bool device_time;  // report the modelled device time
+} bench_t;
+
+// HashTable at various fill levels, with the 30 buckets the game uses
+#define HT_BUCKETS 30
+static HashTable *ht;
+static int ht_fill;
+static int ht_key;
+
+static void ht_setup_n(int fill) {
+  ht = new HashTable(HT_BUCKETS);
+  ht_fill = fill;
+  ht_key = 0;
+  for (int k = 0; k < fill; k++) {
+    ht->set(k, "x");
+  }
+}
+
+static void ht_teardown() {
+  delete ht;
+  ht = NULL;
+}
+
+static void ht_setup_10() { ht_setup_n(10); }
+static void ht_setup_30() { ht_setup_n(30); }
+static void ht_setup_81() { ht_setup_n(81); }
+
+static void ht_get() {
+  ht->get(ht_key);
+  if (++ht_key == ht_fill) {
+    ht_key = 0;
+  }
+}
+
+static void ht_exists_miss() {
+  ht->exists(ht_fill + ht_key);
+  if (++ht_key == ht_fill) {
+    ht_key = 0;
+  }
+}
+
+// Set a new key and remove it again, so the fill level stays put
+static void ht_set_remove() {
+  ht->set(ht_fill, "y");
+  ht->remove(ht_fill);
+}
+
+static void ht_set_existing() {
+  ht->set(ht_key, "z");
+  if (++ht_key == ht_fill) {
+    ht_key = 0;
+  }
+}
+
+// serial_readline_timed() reading server replies
+static const char reply_line[] = "7\r\n";
+
+static void readline_op() {
+  char line[32];
+  host_serial_feed(reply_line, sizeof(reply_line) - 1);
+  serial_readline_timed(line, sizeof(line), 1000);
+}
+
+// A whole check request: the board goes out a cell at a time, each sent
+// on the server's "A", and the result comes back.  The replies are queued
+// up front, so this is the client's side of the exchange only.
+static int bench_board[9][9];
+static char check_replies[81 * 2 + 8];
+
+static void check_setup() {
+  size_t n = 0;
+  for (int i = 0; i < 81; i++) {
+    check_replies[n++] = 'A';
+    check_replies[n++] = '\n';
+  }
+  memcpy(check_replies + n, "D\n1\n", 4);
+}
+
+static void check_op() {
+  host_serial_feed(check_replies, 81 * 2 + 4);
+  check_board(bench_board);
+}
+
+// dprintf formatting; the output goes nowhere
+static void dprintf_op() {
+  dprintf("cell %d,%d = %d after %lu ms", 4, 7, 9, 123456UL);
+}
+
+// lcd_image_draw() of the full board background
+static Adafruit_ST7735 *tft;
+static lcd_image_t board_image = { (char *) "sudoku.lcd", 128, 128 };
+
+static void lcd_setup() {
+  if (tft == NULL) {
+    tft = new Adafruit_ST7735(6, 7, 8);
+    tft->initR(INITR_BLACKTAB);
+    SD.begin(5);
+  }
+  if (!SD.exists(board_image.file_name)) {
+    fprintf(stderr, "bench: %s not found, set HOST_SD_DIR\n", board_image.file_name);
+    exit(1);
+  }
+}
+
+static void lcd_draw_op() {
+  lcd_image_draw(&board_image, tft, 0, 0, 0, 0, 128, 128);
+}
+
+// One board cell's worth of the image, 14 x 14
+static void lcd_cell_op() {
+  lcd_image_draw(&board_image, tft, 30, 30, 30, 30, 14, 14);
+}
+
+// Board solver on an easy and a hard puzzle, and checking a full board
+static const char *const puzzles[] = {
+  // easy: 38 givens
+  "..3.2.6..9..3.5..1..18.64....81.29..7.......8..67.82....26.95..8..2.3..9..5.1.3..",
+  // hard: 21 givens, lots of backtracking
+  "8..........36......7..9.2...5...7.......457.....1...3...1....68..85...1..9....4..",
+  // solved
+  "483921657967345821251876493548132976729564138136798245372689514814253769695417382",
+};
+static uint8_t puzzle_cells[81];
+static board_solver_t solver;
+
+static void load_puzzle(int which) {
+  for (int i = 0; i < 81; i++) {
+    char c = puzzles[which][i];
+    puzzle_cells[i] = (c >= '1' && c <= '9') ? c - '0' : 0;
+  }
+}
+
+static void solve_easy_setup() { load_puzzle(0); }
+static void solve_hard_setup() { load_puzzle(1); }
+static void solve_full_setup() { load_puzzle(2); }
+
+static void solve_op() {
+  board_solver_begin(&solver, puzzle_cells);
+  while (board_solver_run(&solver, 0xFFFF) == SOLVER_RUNNING) {
+  }
+}
+
+static const bench_t benches[] = {
+  { "hashtable_get_10", ht_setup_10, ht_get, ht_teardown, false },
+  { "hashtable_get_30", ht_setup_30, ht_get, ht_teardown, false },
+  { "hashtable_get_81", ht_setup_81, ht_get, ht_teardown, false },
+  { "hashtable_exists_miss_10", ht_setup_10, ht_exists_miss, ht_teardown, false },
+  { "hashtable_exists_miss_81", ht_setup_81, ht_exists_miss, ht_teardown, false },
+  { "hashtable_set_remove_10", ht_setup_10, ht_set_remove, ht_teardown, false },
+  { "hashtable_set_remove_81", ht_setup_81, ht_set_remove, ht_teardown, false },
+  { "hashtable_set_existing_81", ht_setup_81, ht_set_existing, ht_teardown, false },
+  { "serial_readline_timed", NULL, readline_op, NULL, true },
+  { "check_board_exchange", check_setup, check_op, NULL, true },
+  { "dprintf_format", NULL, dprintf_op, NULL, true },
+  { "lcd_image_draw_board", lcd_setup, lcd_draw_op, NULL, true },
+  { "lcd_image_draw_cell", lcd_setup, lcd_cell_op, NULL, true },
+  { "board_solve_easy", solve_easy_setup, solve_op, NULL, false },
+  { "board_solve_hard", solve_hard_setup, solve_op, NULL, false },
+  { "board_check_full", solve_full_setup, solve_op, NULL, false },
+};
+#define NBENCHES (sizeof(benches) / sizeof(benches[0]))
+
+/* Running them */
+
+typedef struct {
+  uint64_t iterations;
+  double ns_per_op;
+  double allocs_per_op;
+  double bytes_per_op;
+  double spi_per_op;
+  double device_ns_per_op;
+} result_t;
+
+static uint64_t wall_now_ns() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t) t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+/* Runs the operation iterations times.  Returns the wall time taken. */
+static uint64_t time_op(const bench_t *b, uint64_t iterations) {
+  uint64_t start = wall_now_ns();
+  for (uint64_t i = 0; i < iterations; i++) {
+    b->op();
+  }
+  return wall_now_ns() - start;
+}
+
+static result_t run(const bench_t *b) {
+  if (b->setup != NULL) {
+    b->setup();
+  }
+
+  // Find an iteration count that takes about BENCH_TARGET_NS
+  uint64_t iterations = 1;
+  for (;;) {
+    uint64_t took = time_op(b, iterations);
+    if (took >= BENCH_TARGET_NS / 10 || iterations >= (1ULL << 32)) {
+      iterations = iterations * BENCH_TARGET_NS / (took > 0 ? took : 1);
+      break;
+    }
+    iterations *= 10;
+  }
+  // A slow first call can make that estimate far too small, so run the
+  // count again until a pass takes roughly the target time
+  for (int pass = 0; pass < BENCH_CALIBRATIONS; pass++) {
+    if (iterations < BENCH_MIN_ITERATIONS) {
+      iterations = BENCH_MIN_ITERATIONS;
+    }
+    uint64_t took = time_op(b, iterations);
+    if (took >= BENCH_TARGET_NS / 2 && took <= BENCH_TARGET_NS * 2) {
+      break;
+    }
+    iterations = iterations * BENCH_TARGET_NS / (took > 0 ? took : 1);
+  }
+  if (iterations < BENCH_MIN_ITERATIONS) {
+    iterations = BENCH_MIN_ITERATIONS;
+  }
+
+  result_t best;
+  best.ns_per_op = -1;
+  for (int r = 0; r < BENCH_REPEATS; r++) {
+    uint64_t allocs = alloc_count;
+    uint64_t bytes = alloc_bytes;
+    uint64_t spi = host_spi_bytes();
+    uint64_t device = host_now_ns();
+    uint64_t start = wall_now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+      b->op();
+    }
+    double ns = (double) (wall_now_ns() - start) / iterations;
+    if (best.ns_per_op < 0 || ns < best.ns_per_op) {
+      best.iterations = iterations;
+      best.ns_per_op = ns;
+      best.allocs_per_op = (double) (alloc_count - allocs) / iterations;
+      best.bytes_per_op = (double) (alloc_bytes - bytes) / iterations;
+      best.spi_per_op = (double) (host_spi_bytes() - spi) / iterations;
+      best.device_ns_per_op = (double) (host_now_ns() - device) / iterations;
+    }
+  }
+
+  if (b->teardown != NULL) {
+    b->teardown();
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  bool json = false;
+  const char *filter = "";
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "usage: %s [--json] [filter]\n", argv[0]);
+      return 2;
+    } else {
+      filter = argv[i];
+    }
+  }
+
+  // Device time is only meaningful on the virtual clock, and nothing
+  // should go out on a real serial port
+  setenv("HOST_CLOCK", "virtual", 1);
+  setenv("HOST_SERIAL", "none", 1);
+  // The board image, next to the sketch
+  char sd_dir[512];
+  snprintf(sd_dir, sizeof(sd_dir), "%s", argv[0]);
+  char *slash = strrchr(sd_dir, '/');
+  snprintf(slash != NULL ? slash + 1 : sd_dir,
+           sizeof(sd_dir) - (slash != NULL ? slash + 1 - sd_dir : 0), "../Images");
+  setenv("HOST_SD_DIR", sd_dir, 0);
+  init();
+  dprintf_control(1);
+
+  if (json) {
+    printf("[\n");
+  } else {
+    printf("name,iterations,ns_per_op,allocs_per_op,bytes_per_op,spi_per_op,device_ns_per_op\n");
+  }
+  bool first = true;
+  for (size_t i = 0; i < NBENCHES; i++) {
+    const bench_t *b = &benches[i];
+    if (strstr(b->name, filter) == NULL) {
+      continue;
+    }
+    result_t r = run(b);
+    char device[32] = "";
+    if (b->device_time) {
+      snprintf(device, sizeof(device), "%.1f", r.device_ns_per_op);
+    }
+    if (json) {
+      printf("%s  {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.2f, "
+             "\"allocs_per_op\": %.3f, \"bytes_per_op\": %.1f, \"spi_per_op\": %.1f, "
+             "\"device_ns_per_op\": %s}",
+             first ? "" : ",\n", b->name, (unsigned long long) r.iterations,
+             r.ns_per_op, r.allocs_per_op, r.bytes_per_op, r.spi_per_op,
+             b->device_time ? device : "null");
+    } else {
+      printf("%s,%llu,%.2f,%.3f,%.1f,%.1f,%s\n", b->name,
+             (unsigned long long) r.iterations, r.ns_per_op, r.allocs_per_op,
+             r.bytes_per_op, r.spi_per_op, device);
+    }
+    fflush(stdout);
+    first = false;
+  }
+  if (json) {
+    printf("\n]\n");
+  }
+  return 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * Internals shared between the parts of the host core.  Not for the
+ * sketch, which only sees the Arduino headers and host.h.
+ */
+
+#ifndef HOST_CORE_H
+#define HOST_CORE_H
+
+#include <stdint.h>
+
+// Modelled costs on a 16 MHz Mega, in nanoseconds
+#define HOST_CALL_NS 1000UL        // a call into the core
+#define HOST_ANALOG_READ_NS 112000UL  // one ADC conversion at 125 kHz
+#define HOST_EEPROM_WRITE_NS 3300000UL
+
+/* Calls every core entry point makes: charges HOST_CALL_NS, then runs any
+ * due timer callbacks and scripted input.
+ */
+void host_call();
+
+/* Sets a pin the way a library poking the port directly would: no call
+ * cost, no timer callbacks.
+ */
+void host_pin_write(uint8_t pin, uint8_t value);
+uint8_t host_pin_read(uint8_t pin);
+
+/* Time one byte takes on the SPI bus at the current clock divider. */
+uint64_t host_spi_byte_ns();
+
+/* Number of bytes sent over SPI so far. */
+uint64_t host_spi_bytes();
+
+/* Sets the SPI clock divider, 2 to 128. */
+void host_spi_set_divider(uint8_t div);
+
+/* Called by the panel whenever a pixel takes a new colour. */
+void host_pixel_changed();
+
+#endif
@@ -0,0 +1,360 @@
+/*
+ * Host Adafruit_GFX and Adafruit_ST7735, drawing into an emulated panel.
+ *
+ * The ST7735 methods talk to the panel the way the real library does,
+ * through chip select, data/command and SPI bytes, so their cost on the
+ * virtual clock is the cost of the bytes they send.  The panel decodes
+ * those bytes into a framebuffer.
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_ST7735.h>
+
+#include "host_core.h"
+
+// Classic 5x7 font, one byte per column, bit 0 at the top, for ' ' to '~'
+static const uint8_t font[95][5] = {
+  { 0x00, 0x00, 0x00, 0x00, 0x00 }, // space
+  { 0x00, 0x00, 0x5F, 0x00, 0x00 }, // !
+  { 0x00, 0x07, 0x00, 0x07, 0x00 }, // "
+  { 0x14, 0x7F, 0x14, 0x7F, 0x14 }, // #
+  { 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, // $
+  { 0x23, 0x13, 0x08, 0x64, 0x62 }, // %
+  { 0x36, 0x49, 0x55, 0x22, 0x50 }, // &
+  { 0x00, 0x05, 0x03, 0x00, 0x00 }, // '
+  { 0x00, 0x1C, 0x22, 0x41, 0x00 }, // (
+  { 0x00, 0x41, 0x22, 0x1C, 0x00 }, // )
+  { 0x14, 0x08, 0x3E, 0x08, 0x14 }, // *
+  { 0x08, 0x08, 0x3E, 0x08, 0x08 }, // +
+  { 0x00, 0x50, 0x30, 0x00, 0x00 }, // ,
+  { 0x08, 0x08, 0x08, 0x08, 0x08 }, // -
+  { 0x00, 0x60, 0x60, 0x00, 0x00 }, // .
+  { 0x20, 0x10, 0x08, 0x04, 0x02 }, // /
+  { 0x3E, 0x51, 0x49, 0x45, 0x3E }, // 0
+  { 0x00, 0x42, 0x7F, 0x40, 0x00 }, // 1
+  { 0x42, 0x61, 0x51, 0x49, 0x46 }, // 2
+  { 0x21, 0x41, 0x45, 0x4B, 0x31 }, // 3
+  { 0x18, 0x14, 0x12, 0x7F, 0x10 }, // 4
+  { 0x27, 0x45, 0x45, 0x45, 0x39 }, // 5
+  { 0x3C, 0x4A, 0x49, 0x49, 0x30 }, // 6
+  { 0x01, 0x71, 0x09, 0x05, 0x03 }, // 7
+  { 0x36, 0x49, 0x49, 0x49, 0x36 }, // 8
+  { 0x06, 0x49, 0x49, 0x29, 0x1E }, // 9
+  { 0x00, 0x36, 0x36, 0x00, 0x00 }, // :
+  { 0x00, 0x56, 0x36, 0x00, 0x00 }, // ;
+  { 0x08, 0x14, 0x22, 0x41, 0x00 }, // <
+  { 0x14, 0x14, 0x14, 0x14, 0x14 }, // =
+  { 0x00, 0x41, 0x22, 0x14, 0x08 }, // >
+  { 0x02, 0x01, 0x51, 0x09, 0x06 }, // ?
+  { 0x32, 0x49, 0x79, 0x41, 0x3E }, // @
+  { 0x7E, 0x11, 0x11, 0x11, 0x7E }, // A
+  { 0x7F, 0x49, 0x49, 0x49, 0x36 }, // B
+  { 0x3E, 0x41, 0x41, 0x41, 0x22 }, // C
+  { 0x7F, 0x41, 0x41, 0x22, 0x1C }, // D
+  { 0x7F, 0x49, 0x49, 0x49, 0x41 }, // E
+  { 0x7F, 0x09, 0x09, 0x09, 0x01 }, // F
+  { 0x3E, 0x41, 0x49, 0x49, 0x7A }, // G
+  { 0x7F, 0x08, 0x08, 0x08, 0x7F }, // H
+  { 0x00, 0x41, 0x7F, 0x41, 0x00 }, // I
+  { 0x20, 0x40, 0x41, 0x3F, 0x01 }, // J
+  { 0x7F, 0x08, 0x14, 0x22, 0x41 }, // K
+  { 0x7F, 0x40, 0x40, 0x40, 0x40 }, // L
+  { 0x7F, 0x02, 0x0C, 0x02, 0x7F }, // M
+  { 0x7F, 0x04, 0x08, 0x10, 0x7F }, // N
+  { 0x3E, 0x41, 0x41, 0x41, 0x3E }, // O
+  { 0x7F, 0x09, 0x09, 0x09, 0x06 }, // P
+  { 0x3E, 0x41, 0x51, 0x21, 0x5E }, // Q
+  { 0x7F, 0x09, 0x19, 0x29, 0x46 }, // R
+  { 0x46, 0x49, 0x49, 0x49, 0x31 }, // S
+  { 0x01, 0x01, 0x7F, 0x01, 0x01 }, // T
+  { 0x3F, 0x40, 0x40, 0x40, 0x3F }, // U
+  { 0x1F, 0x20, 0x40, 0x20, 0x1F }, // V
+  { 0x3F, 0x40, 0x38, 0x40, 0x3F }, // W
+  { 0x63, 0x14, 0x08, 0x14, 0x63 }, // X
+  { 0x07, 0x08, 0x70, 0x08, 0x07 }, // Y
+  { 0x61, 0x51, 0x49, 0x45, 0x43 }, // Z
+  { 0x00, 0x7F, 0x41, 0x41, 0x00 }, // [
+  { 0x02, 0x04, 0x08, 0x10, 0x20 }, // backslash
+  { 0x00, 0x41, 0x41, 0x7F, 0x00 }, // ]
+  { 0x04, 0x02, 0x01, 0x02, 0x04 }, // ^
+  { 0x40, 0x40, 0x40, 0x40, 0x40 }, // _
+  { 0x00, 0x01, 0x02, 0x04, 0x00 }, // `
+  { 0x20, 0x54, 0x54, 0x54, 0x78 }, // a
+  { 0x7F, 0x48, 0x44, 0x44, 0x38 }, // b
+  { 0x38, 0x44, 0x44, 0x44, 0x20 }, // c
+  { 0x38, 0x44, 0x44, 0x48, 0x7F }, // d
+  { 0x38, 0x54, 0x54, 0x54, 0x18 }, // e
+  { 0x08, 0x7E, 0x09, 0x01, 0x02 }, // f
+  { 0x0C, 0x52, 0x52, 0x52, 0x3E }, // g
+  { 0x7F, 0x08, 0x04, 0x04, 0x78 }, // h
+  { 0x00, 0x44, 0x7D, 0x40, 0x00 }, // i
+  { 0x20, 0x40, 0x44, 0x3D, 0x00 }, // j
+  { 0x7F, 0x10, 0x28, 0x44, 0x00 }, // k
+  { 0x00, 0x41, 0x7F, 0x40, 0x00 }, // l
+  { 0x7C, 0x04, 0x18, 0x04, 0x78 }, // m
+  { 0x7C, 0x08, 0x04, 0x04, 0x78 }, // n
+  { 0x38, 0x44, 0x44, 0x44, 0x38 }, // o
+  { 0x7C, 0x14, 0x14, 0x14, 0x08 }, // p
+  { 0x08, 0x14, 0x14, 0x18, 0x7C }, // q
+  { 0x7C, 0x08, 0x04, 0x04, 0x08 }, // r
+  { 0x48, 0x54, 0x54, 0x54, 0x20 }, // s
+  { 0x04, 0x3F, 0x44, 0x40, 0x20 }, // t
+  { 0x3C, 0x40, 0x40, 0x20, 0x7C }, // u
+  { 0x1C, 0x20, 0x40, 0x20, 0x1C }, // v
+  { 0x3C, 0x40, 0x30, 0x40, 0x3C }, // w
+  { 0x44, 0x28, 0x10, 0x28, 0x44 }, // x
+  { 0x0C, 0x50, 0x50, 0x50, 0x3C }, // y
+  { 0x44, 0x64, 0x54, 0x4C, 0x44 }, // z
+  { 0x00, 0x08, 0x36, 0x41, 0x00 }, // {
+  { 0x00, 0x00, 0x7F, 0x00, 0x00 }, // |
+  { 0x00, 0x41, 0x36, 0x08, 0x00 }, // }
+  { 0x10, 0x08, 0x08, 0x10, 0x08 }, // ~
+};
+
+Adafruit_ST7735 *host_tft = NULL;
+
+/* Adafruit_GFX */
+
+Adafruit_GFX::Adafruit_GFX(int16_t w, int16_t h)
+  : _width(w), _height(h), cursor_x(0), cursor_y(0),
+    textcolor(0xFFFF), textbgcolor(0xFFFF), textsize(1), wrap(true) {
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                            uint16_t color) {
+  for (int16_t i = x; i < x + w; i++) {
+    drawFastVLine(i, y, h, color);
+  }
+}
+
+void Adafruit_GFX::fillScreen(uint16_t color) {
+  fillRect(0, 0, _width, _height, color);
+}
+
+void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  for (int16_t i = 0; i < w; i++) {
+    drawPixel(x + i, y, color);
+  }
+}
+
+void Adafruit_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  for (int16_t i = 0; i < h; i++) {
+    drawPixel(x, y + i, color);
+  }
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                            uint16_t color) {
+  drawFastHLine(x, y, w, color);
+  drawFastHLine(x, y + h - 1, w, color);
+  drawFastVLine(x, y, h, color);
+  drawFastVLine(x + w - 1, y, h, color);
+}
+
+// Like the library: a pixel (or size x size block) at a time, the
+// background too unless it is the same colour as the text.
+void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c,
+                            uint16_t color, uint16_t bg, uint8_t size) {
+  if (x >= _width || y >= _height || x + 6 * size - 1 < 0 || y + 8 * size - 1 < 0) {
+    return;
+  }
+  for (int8_t i = 0; i < 6; i++) {
+    uint8_t line = 0;
+    if (i < 5 && c >= ' ' && c <= '~') {
+      line = font[c - ' '][i];
+    }
+    for (int8_t j = 0; j < 8; j++, line >>= 1) {
+      uint16_t pixel;
+      if (line & 1) {
+        pixel = color;
+      } else if (bg != color) {
+        pixel = bg;
+      } else {
+        continue;
+      }
+      if (size == 1) {
+        drawPixel(x + i, y + j, pixel);
+      } else {
+        fillRect(x + i * size, y + j * size, size, size, pixel);
+      }
+    }
+  }
+}
+
+size_t Adafruit_GFX::write(uint8_t c) {
+  if (c == '\n') {
+    cursor_y += textsize * 8;
+    cursor_x = 0;
+  } else if (c != '\r') {
+    drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize);
+    cursor_x += textsize * 6;
+    if (wrap && cursor_x > _width - textsize * 6) {
+      cursor_y += textsize * 8;
+      cursor_x = 0;
+    }
+  }
+  return 1;
+}
+
+/* Adafruit_ST7735, the library side */
+
+Adafruit_ST7735::Adafruit_ST7735(uint8_t cs, uint8_t dc, uint8_t rst)
+  : Adafruit_GFX(ST7735_TFTWIDTH, ST7735_TFTHEIGHT), cs(cs), dc(dc),
+    cmd(0), nargs(0), win_x0(0), win_y0(0),
+    win_x1(ST7735_TFTWIDTH - 1), win_y1(ST7735_TFTHEIGHT - 1),
+    at_x(0), at_y(0), high_byte_pending(false), high_byte(0) {
+  (void) rst;
+  memset(fb, 0, sizeof(fb));
+}
+
+void Adafruit_ST7735::command(uint8_t c) {
+  host_pin_write(dc, LOW);
+  host_pin_write(cs, LOW);
+  SPI.transfer(c);
+  host_pin_write(cs, HIGH);
+}
+
+void Adafruit_ST7735::data(uint8_t d) {
+  host_pin_write(dc, HIGH);
+  host_pin_write(cs, LOW);
+  SPI.transfer(d);
+  host_pin_write(cs, HIGH);
+}
+
+void Adafruit_ST7735::initR(uint8_t options) {
+  (void) options;
+  host_spi_attach(cs, dc, this);
+  host_tft = this;
+  host_pin_write(cs, HIGH);
+  SPI.begin();
+  SPI.setClockDivider(SPI_CLOCK_DIV4);
+
+  // The command list of the real initR() waits this long in total, for
+  // the reset, wake up and display on
+  command(0x01);  // SWRESET
+  delay(150);
+  command(0x11);  // SLPOUT
+  delay(500);
+  command(0x13);  // NORON
+  delay(10);
+  command(0x29);  // DISPON
+  delay(100);
+}
+
+void Adafruit_ST7735::setAddrWindow(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
+  command(ST7735_CASET);
+  data(0);
+  data(x0);
+  data(0);
+  data(x1);
+  command(ST7735_RASET);
+  data(0);
+  data(y0);
+  data(0);
+  data(y1);
+  command(ST7735_RAMWR);
+}
+
+void Adafruit_ST7735::pushColor(uint16_t color) {
+  host_pin_write(dc, HIGH);
+  host_pin_write(cs, LOW);
+  SPI.transfer(color >> 8);
+  SPI.transfer(color);
+  host_pin_write(cs, HIGH);
+}
+
+void Adafruit_ST7735::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if (x < 0 || x >= _width || y < 0 || y >= _height) {
+    return;
+  }
+  setAddrWindow(x, y, x + 1, y + 1);
+  pushColor(color);
+}
+
+void Adafruit_ST7735::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                               uint16_t color) {
+  if (x >= _width || y >= _height) {
+    return;
+  }
+  if (x + w - 1 >= _width) {
+    w = _width - x;
+  }
+  if (y + h - 1 >= _height) {
+    h = _height - y;
+  }
+  setAddrWindow(x, y, x + w - 1, y + h - 1);
+  host_pin_write(dc, HIGH);
+  host_pin_write(cs, LOW);
+  for (int32_t i = (int32_t) w * h; i > 0; i--) {
+    SPI.transfer(color >> 8);
+    SPI.transfer(color);
+  }
+  host_pin_write(cs, HIGH);
+}
+
+void Adafruit_ST7735::fillScreen(uint16_t color) {
+  fillRect(0, 0, _width, _height, color);
+}
+
+uint16_t Adafruit_ST7735::Color565(uint8_t r, uint8_t g, uint8_t b) {
+  return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+/* Adafruit_ST7735, the panel side */
+
+void Adafruit_ST7735::spi_byte(uint8_t b, bool is_command) {
+  if (is_command) {
+    cmd = b;
+    nargs = 0;
+    high_byte_pending = false;
+    if (cmd == ST7735_RAMWR) {
+      at_x = win_x0;
+      at_y = win_y0;
+    }
+    return;
+  }
+
+  switch (cmd) {
+    case ST7735_CASET:
+    case ST7735_RASET:
+      if (nargs < 4) {
+        args[nargs++] = b;
+      }
+      if (nargs == 4) {
+        if (cmd == ST7735_CASET) {
+          win_x0 = args[1];
+          win_x1 = args[3];
+        } else {
+          win_y0 = args[1];
+          win_y1 = args[3];
+        }
+      }
+      break;
+
+    case ST7735_RAMWR:
+      if (!high_byte_pending) {
+        high_byte = b;
+        high_byte_pending = true;
+        break;
+      }
+      high_byte_pending = false;
+      if (at_x < ST7735_TFTWIDTH && at_y < ST7735_TFTHEIGHT) {
+        uint16_t *p = &fb[at_y * ST7735_TFTWIDTH + at_x];
+        uint16_t colour = (high_byte << 8) | b;
+        if (*p != colour) {
+          *p = colour;
+          host_pixel_changed();
+        }
+      }
+      // Fill the window a row at a time, wrapping back to its top
+      if (at_x >= win_x1) {
+        at_x = win_x0;
+        at_y = at_y >= win_y1 ? win_y0 : at_y + 1;
+      } else {
+        at_x++;
+      }
+      break;
+  }
+}
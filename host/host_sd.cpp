@@ -0,0 +1,160 @@
+/*
+ * Host SD library: files come from HOST_SD_DIR.
+ *
+ * Like the real library, reads go through a single 512 byte block cache.
+ * Each block brought into it is charged to the virtual clock as a block
+ * read over SPI at the current clock rate, plus the card's access time.
+ */
+
+#include <Arduino.h>
+#include <SD.h>
+
+#include <unistd.h>
+
+#include "host_core.h"
+
+#define SD_BLOCK 512
+#define SD_INIT_NS 50000000ULL     // power up and identify the card
+#define SD_ACCESS_NS 400000ULL     // from read command to first data byte
+#define SD_COPY_NS 250ULL          // copying a byte out of the cache
+
+SDClass SD;
+
+// The block in the cache, by file and block number
+static FILE *cache_file = NULL;
+static long cache_block = -1;
+
+static const char *sd_dir() {
+  const char *dir = getenv("HOST_SD_DIR");
+  return dir != NULL ? dir : "Images";
+}
+
+static void load_block(FILE *f, long block) {
+  if (f == cache_file && block == cache_block) {
+    return;
+  }
+  cache_file = f;
+  cache_block = block;
+  host_spend_ns(SD_ACCESS_NS + (SD_BLOCK + 8) * host_spi_byte_ns());
+}
+
+static void card_init(uint8_t sck_rate) {
+  host_call();
+  host_spi_set_divider(2 << sck_rate);
+  host_spend_ns(SD_INIT_NS);
+}
+
+bool SDClass::begin(uint8_t cs_pin) {
+  (void) cs_pin;
+  card_init(SPI_HALF_SPEED);
+  // Master boot record, volume boot block and the first FAT block
+  for (long block = 0; block < 3; block++) {
+    load_block(NULL, block);
+  }
+  return true;
+}
+
+File SDClass::open(const char *path, uint8_t mode) {
+  host_call();
+  load_block(NULL, -2);  // the root directory
+  char full[512];
+  snprintf(full, sizeof(full), "%s/%s", sd_dir(), path);
+  return File(fopen(full, mode == FILE_WRITE ? "a+b" : "rb"));
+}
+
+bool SDClass::exists(const char *path) {
+  File f = open(path);
+  bool found = f;
+  f.close();
+  return found;
+}
+
+bool SDClass::remove(const char *path) {
+  host_call();
+  load_block(NULL, -2);  // the root directory
+  char full[512];
+  snprintf(full, sizeof(full), "%s/%s", sd_dir(), path);
+  return unlink(full) == 0;
+}
+
+bool Sd2Card::init(uint8_t sck_rate, uint8_t cs_pin) {
+  (void) cs_pin;
+  card_init(sck_rate);
+  return true;
+}
+
+bool Sd2Card::readBlock(uint32_t block, uint8_t *dst) {
+  (void) block;
+  host_call();
+  load_block(NULL, -3 - (long) block);
+  memset(dst, 0, SD_BLOCK);
+  return true;
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::read(void *buf, uint16_t nbyte) {
+  host_call();
+  if (fp == NULL) {
+    return -1;
+  }
+  long pos = ftell(fp);
+  size_t n = fread(buf, 1, nbyte, fp);
+  for (long block = pos / SD_BLOCK; n > 0 && block <= (pos + (long) n - 1) / SD_BLOCK; block++) {
+    load_block(fp, block);
+  }
+  host_spend_ns(n * SD_COPY_NS);
+  return n;
+}
+
+size_t File::write(const uint8_t *buf, size_t size) {
+  host_call();
+  if (fp == NULL) {
+    return 0;
+  }
+  long pos = ftell(fp);
+  size_t n = fwrite(buf, 1, size, fp);
+  for (long block = pos / SD_BLOCK; n > 0 && block <= (pos + (long) n - 1) / SD_BLOCK; block++) {
+    load_block(fp, block);
+  }
+  host_spend_ns(n * SD_COPY_NS);
+  return n;
+}
+
+bool File::seek(uint32_t pos) {
+  host_call();
+  return fp != NULL && fseek(fp, pos, SEEK_SET) == 0;
+}
+
+uint32_t File::position() {
+  return fp != NULL ? ftell(fp) : 0;
+}
+
+uint32_t File::size() {
+  if (fp == NULL) {
+    return 0;
+  }
+  long here = ftell(fp);
+  fseek(fp, 0, SEEK_END);
+  long end = ftell(fp);
+  fseek(fp, here, SEEK_SET);
+  return end;
+}
+
+int File::available() {
+  return size() - position();
+}
+
+void File::close() {
+  if (fp != NULL) {
+    if (cache_file == fp) {
+      cache_file = NULL;
+      cache_block = -1;
+    }
+    fclose(fp);
+    fp = NULL;
+  }
+}
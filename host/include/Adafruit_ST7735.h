@@ -0,0 +1,69 @@
+/*
+ * Host stand-in for Adafruit_ST7735, old API (setAddrWindow takes corners).
+ *
+ * The display is emulated at the SPI level: the controller decodes the
+ * column and row address and memory write commands from the bytes it is
+ * sent, so code that talks to the panel through SPI.transfer() directly
+ * draws exactly like it does on the board.
+ */
+
+#ifndef HOST_ADAFRUIT_ST7735_H
+#define HOST_ADAFRUIT_ST7735_H
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <SPI.h>
+
+#define INITR_GREENTAB 0x0
+#define INITR_REDTAB   0x1
+#define INITR_BLACKTAB 0x2
+
+#define ST7735_TFTWIDTH  128
+#define ST7735_TFTHEIGHT 160
+
+#define ST7735_CASET 0x2A
+#define ST7735_RASET 0x2B
+#define ST7735_RAMWR 0x2C
+
+#define ST7735_BLACK   0x0000
+#define ST7735_BLUE    0x001F
+#define ST7735_RED     0xF800
+#define ST7735_GREEN   0x07E0
+#define ST7735_CYAN    0x07FF
+#define ST7735_MAGENTA 0xF81F
+#define ST7735_YELLOW  0xFFE0
+#define ST7735_WHITE   0xFFFF
+
+class Adafruit_ST7735 : public Adafruit_GFX, public HostSPIDevice {
+public:
+  Adafruit_ST7735(uint8_t cs, uint8_t dc, uint8_t rst);
+
+  void initR(uint8_t options = INITR_GREENTAB);
+  void setAddrWindow(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+  void pushColor(uint16_t color);
+  void drawPixel(int16_t x, int16_t y, uint16_t color);
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void fillScreen(uint16_t color);
+  uint16_t Color565(uint8_t r, uint8_t g, uint8_t b);
+
+  void spi_byte(uint8_t data, bool command);
+
+  /* Contents of the emulated panel, row major. */
+  const uint16_t *pixels() const { return fb; }
+
+private:
+  void command(uint8_t c);
+  void data(uint8_t d);
+
+  uint8_t cs, dc;
+  uint16_t fb[ST7735_TFTWIDTH * ST7735_TFTHEIGHT];
+  uint8_t cmd, nargs, args[4];
+  uint8_t win_x0, win_y0, win_x1, win_y1, at_x, at_y;
+  bool high_byte_pending;
+  uint8_t high_byte;
+};
+
+/* The panel most recently initialized, for host_exit() to dump. */
+extern Adafruit_ST7735 *host_tft;
+
+#endif
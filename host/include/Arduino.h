@@ -0,0 +1,121 @@
+/*
+ * Host stand-in for the Arduino core.
+ *
+ * Only what the sketch uses is provided.  Time comes from the host clock
+ * (see host.h), pins from the scripted input source, and Serial from a
+ * pty, a pair of file descriptors or nothing at all.
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define DEC 10
+#define HEX 16
+
+#define F_CPU 16000000UL
+
+// Analog pins of the Mega, as digital pin numbers
+#define A0 54
+#define A1 55
+#define A2 56
+#define A3 57
+#define A4 58
+#define A5 59
+#define A6 60
+#define A7 61
+#define A8 62
+#define A9 63
+#define A10 64
+#define A11 65
+#define A12 66
+#define A13 67
+#define A14 68
+#define A15 69
+
+#define _BV(bit) (1 << (bit))
+
+// Timer callbacks run between calls into the core, never in the middle of
+// sketch code, so there is nothing to mask.
+#define noInterrupts()
+#define interrupts()
+#define cli()
+#define sei()
+
+void init();
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+#include "avr/pgmspace.h"
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t size);
+  size_t write(const char *str) {
+    return str == NULL ? 0 : write((const uint8_t *) str, strlen(str));
+  }
+
+  size_t print(const char *s) { return write(s); }
+  size_t print(char c) { return write((uint8_t) c); }
+  size_t print(unsigned char n, int base = DEC) { return print((unsigned long) n, base); }
+  size_t print(int n, int base = DEC) { return print((long) n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long) n, base); }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(double n, int digits = 2);
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+  template <typename T> size_t println(T v, int f) { size_t n = print(v, f); return n + println(); }
+};
+
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud);
+  void end();
+  int available();
+  int peek();
+  int read();
+  void flush();
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buf, size_t size);
+  using Print::write;
+  operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#include "host.h"
+
+#endif
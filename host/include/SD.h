@@ -0,0 +1,56 @@
+/*
+ * Host stand-in for the SD library.  The card is a directory on the host,
+ * HOST_SD_DIR, and reads are charged to the virtual clock at the speed
+ * the SPI bus was set up for.  Files opened with FILE_WRITE are appended
+ * to, and each block written is charged the same as a block read.
+ */
+
+#ifndef HOST_SD_H
+#define HOST_SD_H
+
+#include <Arduino.h>
+
+#define SPI_FULL_SPEED 0
+#define SPI_HALF_SPEED 1
+#define SPI_QUARTER_SPEED 2
+
+#define FILE_READ 1
+#define FILE_WRITE 2
+
+class File : public Print {
+public:
+  File() : fp(NULL) {}
+  explicit File(FILE *f) : fp(f) {}
+  operator bool() const { return fp != NULL; }
+  bool operator==(const void *p) const { return (const void *) fp == p; }
+  int read();
+  int read(void *buf, uint16_t nbyte);
+  using Print::write;
+  size_t write(uint8_t c) { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t size);
+  bool seek(uint32_t pos);
+  uint32_t position();
+  uint32_t size();
+  int available();
+  void close();
+private:
+  FILE *fp;
+};
+
+class SDClass {
+public:
+  bool begin(uint8_t cs_pin = 0xFF);
+  File open(const char *path, uint8_t mode = FILE_READ);
+  bool exists(const char *path);
+  bool remove(const char *path);
+};
+
+extern SDClass SD;
+
+class Sd2Card {
+public:
+  bool init(uint8_t sck_rate = SPI_FULL_SPEED, uint8_t cs_pin = 0xFF);
+  bool readBlock(uint32_t block, uint8_t *dst);
+};
+
+#endif
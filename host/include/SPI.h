@@ -0,0 +1,46 @@
+/*
+ * Host stand-in for the SPI library.  Bytes sent while a chip select line
+ * is low go to the device registered for that line (see Adafruit_ST7735.h).
+ */
+
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include <Arduino.h>
+
+// Same codes as the AVR SPI library
+#define SPI_CLOCK_DIV4 0x00
+#define SPI_CLOCK_DIV16 0x01
+#define SPI_CLOCK_DIV64 0x02
+#define SPI_CLOCK_DIV128 0x03
+#define SPI_CLOCK_DIV2 0x04
+#define SPI_CLOCK_DIV8 0x05
+#define SPI_CLOCK_DIV32 0x06
+#define SPI_MODE0 0x00
+#define MSBFIRST 1
+
+class SPIClass {
+public:
+  void begin();
+  void end();
+  uint8_t transfer(uint8_t data);
+  void setClockDivider(uint8_t div);
+  void setDataMode(uint8_t mode);
+  void setBitOrder(uint8_t order);
+};
+
+extern SPIClass SPI;
+
+/* A device on the SPI bus, selected by a chip select pin. */
+class HostSPIDevice {
+public:
+  virtual ~HostSPIDevice() {}
+  virtual void spi_byte(uint8_t data, bool command) = 0;
+};
+
+/* Routes bytes sent while cs_pin is low to dev.  dc_pin, if not 0xFF,
+ * tells commands (low) from data (high).
+ */
+void host_spi_attach(uint8_t cs_pin, uint8_t dc_pin, HostSPIDevice *dev);
+
+#endif
@@ -0,0 +1,22 @@
+/*
+ * Host stand-in for avr/eeprom.h.  The 4 KB EEPROM of the Mega is kept in
+ * the file named by HOST_EEPROM, if set, so it survives between runs like
+ * the real one survives a reset.  Writes are charged 3.3 ms each on the
+ * virtual clock, during which eeprom_is_ready() is false.
+ */
+
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define E2END 0x0FFF
+
+uint8_t eeprom_read_byte(const uint8_t *addr);
+void eeprom_read_block(void *dst, const void *src, size_t n);
+void eeprom_write_byte(uint8_t *addr, uint8_t value);
+void eeprom_update_byte(uint8_t *addr, uint8_t value);
+bool eeprom_is_ready();
+
+#endif
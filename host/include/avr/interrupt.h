@@ -0,0 +1,12 @@
+/*
+ * Host stand-in for avr/interrupt.h.  Code that sets up timers or the ADC
+ * is only built for the AVR; off target the same work is driven by
+ * host_every() callbacks.
+ */
+
+#ifndef HOST_INTERRUPT_H
+#define HOST_INTERRUPT_H
+
+#include <Arduino.h>
+
+#endif
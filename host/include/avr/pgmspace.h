@@ -0,0 +1,21 @@
+/*
+ * Host stand-in for avr/pgmspace.h: flash and RAM are the same thing.
+ */
+
+#ifndef HOST_PGMSPACE_H
+#define HOST_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *) (addr))
+#define pgm_read_word(addr) (*(const uint16_t *) (addr))
+#define pgm_read_dword(addr) (*(const uint32_t *) (addr))
+#define pgm_read_ptr(addr) (*(void * const *) (addr))
+#define strcpy_P(dst, src) strcpy((dst), (src))
+#define strlen_P(s) strlen(s)
+#define memcpy_P(dst, src, n) memcpy((dst), (src), (n))
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Extras of the host build that have no Arduino equivalent.
+ *
+ * The host build is configured through environment variables, read the
+ * first time the sketch calls into the core:
+ *
+ *   HOST_CLOCK    real (default): millis() follows the wall clock.
+ *                 virtual: time only moves when the sketch spends it, on
+ *                 delay(), SPI and SD traffic, and a small cost per call
+ *                 into the core, so a run is repeatable.  While waiting on
+ *                 serial input the clock follows the wall clock.
+ *   HOST_SERIAL   pty (default): open a pseudo terminal and print the path
+ *                 of its slave end, to hand to sudokuServer.py -s.
+ *                 stdio: use stdin and stdout.
+ *                 fd:IN,OUT: use already open file descriptors.
+ *                 none: discard output, never receive anything.
+ *                 anything else: path of a serial device or pty to open.
+ *   HOST_SD_DIR   directory standing in for the SD card (default Images).
+ *   HOST_EEPROM   file holding the EEPROM, so it is kept between runs.
+ *                 Without it the EEPROM starts erased every run.
+ *   HOST_INPUT    script of timed pin changes, one per line:
+ *                     <millis> <pin> <value>
+ *                 where pin is a digital pin number or A0-A15, or
+ *                     <millis> serial <line>
+ *                 for a line received on Serial at that time (or once
+ *                 the sketch has sent something since the last one, if
+ *                 that is later).  '#' starts a comment.  A line
+ *                 "<millis> end" stops the run; without one, the run
+ *                 stops a second after the last line, once the input it
+ *                 made has reached the screen.
+ *                 The client writes recorded sessions in this format.
+ *   HOST_LATENCY  file to write, for each input event, the time from the
+ *                 pin change behind it to the first pixel it changed, as
+ *                 CSV.  A summary is printed when the run stops.
+ *   HOST_EXIT_MS  stop the run at this time.
+ *   HOST_PPM      when the run stops, write the screen to this file.
+ */
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Nanoseconds since the run started on the host clock. */
+uint64_t host_now_ns();
+
+/* Charges ns of modelled work to the virtual clock.  Does nothing on the
+ * real clock, where the work takes however long it takes.
+ */
+void host_spend_ns(uint64_t ns);
+
+/* Calls fn every period_us, standing in for a timer interrupt.  Callbacks
+ * run the next time the sketch calls into the core once they are due.
+ */
+void host_every(unsigned long period_us, void (*fn)());
+
+/* Uses the given file descriptors for Serial from now on. */
+void host_serial_attach(int in_fd, int out_fd);
+
+/* Queues bytes on Serial as if they had just been received. */
+void host_serial_feed(const void *bytes, size_t n);
+
+/* Tells the core the sketch turned the inputs into an event, named for
+ * the HOST_LATENCY report.
+ */
+void host_input_event(const char *name);
+
+/* Sets the level of a digital pin or the reading of an analog pin. */
+void host_set_pin(uint8_t pin, int value);
+
+/* Stops the run: writes HOST_PPM if set and exits. */
+void host_exit(int status);
+
+#endif
@@ -0,0 +1,370 @@
+/*
+ * Protocol load generator: many virtual clients against the real server.
+ *
+ *   make -C host loadgen && host/loadgen [options]
+ *
+ *   -n N        clients, each with its own server process (default 4)
+ *   -r N        requests per client (default 20)
+ *   -t SECONDS  stop each client after this long instead
+ *   -m C,F,G    weights of check, solve and generate requests (default 1,1,1)
+ *   -g N        difficulty asked for in generate requests (default 2)
+ *   -b BAUD     serial speed the clients send at (default 9600)
+ *   -s SEED     random seed (default 1)
+ *   --json      JSON instead of CSV
+ *
+ * Each client is a process running serial_handling.cpp, the same code the
+ * Arduino runs, on the master end of a pseudo terminal.  Its server is
+ * "python3 sudokuServer.py -s 0" on the slave end, so the server sees a
+ * line just like the Arduino's.  Generated boards are solved, and solved
+ * boards checked, so every request is one a game could make.
+ *
+ * After one untimed request each, which waits out the servers' start up,
+ * all clients start together.  Results go to stdout, one row per request
+ * type and one for all of them:
+ *
+ *   type        C, F, G or all
+ *   requests    requests made
+ *   errors      requests that timed out or were refused
+ *   per_s       requests finished per second, over all clients
+ *   mean_ms, p50_ms, p95_ms, p99_ms, max_ms   latency, request to answer
+ */
+
+#include <Arduino.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "serial_handling.h"
+
+#define LOADGEN_TYPES 3
+static const char loadgen_types[LOADGEN_TYPES] = { 'C', 'F', 'G' };
+
+typedef struct {
+  int clients;
+  int requests;
+  double seconds;
+  int weights[LOADGEN_TYPES];
+  int difficulty;
+  unsigned long baud;
+  unsigned seed;
+  bool json;
+} options_t;
+
+// What a client reports for each request, over a pipe shared by all of
+// them; small enough for each write to arrive in one piece.
+typedef struct {
+  char type;         // 'C', 'F', 'G', or 'R' once the client is ready
+  bool ok;
+  uint64_t latency_ns;
+} record_t;
+
+// A board to start from, and its solution, until the server has
+// generated one
+static const char start_puzzle[] =
+  "530070000600195000098000060800060003400803001700020006060000280000419005000080079";
+static const char start_solution[] =
+  "534678912672195348198342567859761423426853791713924856961537284287419635345286179";
+
+static uint64_t wall_now_ns() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t) t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static void parse_board(const char *s, int board[9][9]) {
+  for (int i = 0; i < 81; i++) {
+    board[i / 9][i % 9] = s[i] - '0';
+  }
+}
+
+/* Client side */
+
+/* Starts a server on the slave end of a new pty.  Returns the master end,
+ * and the server's pid in *server.
+ */
+static int start_server(const char *server_dir, pid_t *server) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+    perror("loadgen: pty");
+    exit(1);
+  }
+  int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  if (slave < 0) {
+    perror("loadgen: pty slave");
+    exit(1);
+  }
+  // Raw on both ends, so nothing is echoed back to the client
+  struct termios t;
+  tcgetattr(slave, &t);
+  cfmakeraw(&t);
+  tcsetattr(slave, TCSANOW, &t);
+  tcsetattr(master, TCSANOW, &t);
+
+  *server = fork();
+  if (*server == 0) {
+    dup2(slave, 0);
+    dup2(slave, 1);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, 2);
+    close(master);
+    if (chdir(server_dir) < 0) {
+      _exit(127);
+    }
+    execlp("python3", "python3", "sudokuServer.py", "-s", "0", "-d0", (char *) NULL);
+    _exit(127);
+  }
+  close(slave);
+  return master;
+}
+
+/* Runs one request to the end, waiting on the line rather than spinning
+ * so that the clients leave the CPU to the servers.
+ */
+static bool request(int fd, char type, int difficulty, int board[9][9]) {
+  switch (type) {
+    case 'C': proto_check(board); break;
+    case 'F': proto_solve(board); break;
+    case 'G': proto_generate(difficulty, board); break;
+  }
+  while (proto_pump() == PROTO_BUSY) {
+    struct pollfd p = { fd, POLLIN, 0 };
+    poll(&p, 1, 10);
+  }
+  if (proto_status() != PROTO_DONE) {
+    return false;
+  }
+  return type != 'C' || proto_result() == 1;
+}
+
+static void send_record(int fd, char type, bool ok, uint64_t latency_ns) {
+  record_t r = { type, ok, latency_ns };
+  if (write(fd, &r, sizeof(r)) != sizeof(r)) {
+    _exit(1);
+  }
+}
+
+static void run_client(int id, const options_t *o, const char *server_dir,
+                       int result_fd, int go_fd) {
+  pid_t server;
+  int fd = start_server(server_dir, &server);
+  host_serial_attach(fd, fd);
+  Serial.begin(o->baud);
+
+  int puzzle[9][9], solution[9][9], board[9][9];
+  parse_board(start_puzzle, puzzle);
+  parse_board(start_solution, solution);
+
+  // One request to wait out the server's start up
+  memcpy(board, solution, sizeof(board));
+  request(fd, 'C', o->difficulty, board);
+  send_record(result_fd, 'R', true, 0);
+  char go;
+  if (read(go_fd, &go, 1) != 1) {
+    _exit(1);
+  }
+
+  srandom(o->seed * 7919 + id);
+  int total = 0;
+  for (int i = 0; i < LOADGEN_TYPES; i++) {
+    total += o->weights[i];
+  }
+  uint64_t start = wall_now_ns();
+  for (int n = 0; o->seconds > 0 || n < o->requests; n++) {
+    if (o->seconds > 0 && wall_now_ns() - start >= o->seconds * 1e9) {
+      break;
+    }
+    int pick = random() % total, type = 0;
+    while (pick >= o->weights[type]) {
+      pick -= o->weights[type++];
+    }
+    char t = loadgen_types[type];
+
+    memcpy(board, t == 'C' ? solution : puzzle, sizeof(board));
+    uint64_t before = wall_now_ns();
+    bool ok = request(fd, t, o->difficulty, board);
+    send_record(result_fd, t, ok, wall_now_ns() - before);
+
+    // Keep the boards the server sent for the next requests
+    if (ok && t == 'G') {
+      memcpy(puzzle, board, sizeof(board));
+    } else if (ok && t == 'F') {
+      memcpy(solution, board, sizeof(board));
+    }
+  }
+
+  close(fd);
+  kill(server, SIGTERM);
+  waitpid(server, NULL, 0);
+}
+
+/* Reporting */
+
+static double percentile_ms(const std::vector<uint64_t> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t rank = (size_t) (p / 100.0 * sorted.size() + 0.999999);
+  rank = std::max<size_t>(1, std::min(rank, sorted.size()));
+  return sorted[rank - 1] / 1e6;
+}
+
+static void report(const char *type, std::vector<uint64_t> latencies, int errors,
+                   double seconds, bool json, bool first) {
+  std::sort(latencies.begin(), latencies.end());
+  size_t n = latencies.size();
+  double sum = 0;
+  for (size_t i = 0; i < n; i++) {
+    sum += latencies[i];
+  }
+  double mean = n > 0 ? sum / n / 1e6 : 0;
+  double per_s = seconds > 0 ? (n - errors) / seconds : 0;
+  if (json) {
+    printf("%s  {\"type\": \"%s\", \"requests\": %zu, \"errors\": %d, \"per_s\": %.2f, "
+           "\"mean_ms\": %.2f, \"p50_ms\": %.2f, \"p95_ms\": %.2f, \"p99_ms\": %.2f, "
+           "\"max_ms\": %.2f}",
+           first ? "" : ",\n", type, n, errors, per_s, mean,
+           percentile_ms(latencies, 50), percentile_ms(latencies, 95),
+           percentile_ms(latencies, 99), percentile_ms(latencies, 100));
+  } else {
+    printf("%s,%zu,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n", type, n, errors, per_s,
+           mean, percentile_ms(latencies, 50), percentile_ms(latencies, 95),
+           percentile_ms(latencies, 99), percentile_ms(latencies, 100));
+  }
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "usage: %s [-n clients] [-r requests | -t seconds] [-m C,F,G]\n"
+                  "       [-g difficulty] [-b baud] [-s seed] [--json]\n", name);
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  options_t o = { 4, 20, 0, { 1, 1, 1 }, 2, 9600, 1, false };
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (strcmp(arg, "--json") == 0) {
+      o.json = true;
+      continue;
+    }
+    if (value == NULL) {
+      usage(argv[0]);
+    }
+    i++;
+    if (strcmp(arg, "-n") == 0) {
+      o.clients = atoi(value);
+    } else if (strcmp(arg, "-r") == 0) {
+      o.requests = atoi(value);
+    } else if (strcmp(arg, "-t") == 0) {
+      o.seconds = atof(value);
+    } else if (strcmp(arg, "-m") == 0) {
+      if (sscanf(value, "%d,%d,%d", &o.weights[0], &o.weights[1], &o.weights[2]) != 3) {
+        usage(argv[0]);
+      }
+    } else if (strcmp(arg, "-g") == 0) {
+      o.difficulty = atoi(value);
+    } else if (strcmp(arg, "-b") == 0) {
+      o.baud = strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "-s") == 0) {
+      o.seed = strtoul(value, NULL, 10);
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (o.clients < 1 || o.weights[0] + o.weights[1] + o.weights[2] <= 0 ||
+      o.weights[0] < 0 || o.weights[1] < 0 || o.weights[2] < 0) {
+    usage(argv[0]);
+  }
+
+  // The server, next to the sketch
+  char server_dir[512];
+  snprintf(server_dir, sizeof(server_dir), "%s", argv[0]);
+  char *slash = strrchr(server_dir, '/');
+  snprintf(slash != NULL ? slash + 1 : server_dir,
+           sizeof(server_dir) - (slash != NULL ? slash + 1 - server_dir : 0),
+           "../server_files");
+
+  // Each client attaches its own pty once forked
+  setenv("HOST_CLOCK", "real", 1);
+  setenv("HOST_SERIAL", "none", 1);
+
+  int results[2], go[2];
+  if (pipe(results) < 0 || pipe(go) < 0) {
+    perror("loadgen: pipe");
+    return 1;
+  }
+  std::vector<pid_t> clients;
+  for (int i = 0; i < o.clients; i++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(results[0]);
+      close(go[1]);
+      init();
+      run_client(i, &o, server_dir, results[1], go[0]);
+      _exit(0);
+    }
+    clients.push_back(pid);
+  }
+  close(results[1]);
+  close(go[0]);
+
+  std::vector<uint64_t> latencies[LOADGEN_TYPES + 1];
+  int errors[LOADGEN_TYPES + 1] = { 0 };
+  int ready = 0;
+  uint64_t start = 0;
+  record_t r;
+  while (read(results[0], &r, sizeof(r)) == sizeof(r)) {
+    if (r.type == 'R') {
+      if (++ready == o.clients) {
+        // Everyone is up: start the clock and let them go
+        start = wall_now_ns();
+        for (int i = 0; i < o.clients; i++) {
+          if (write(go[1], "g", 1) != 1) {
+            perror("loadgen: go");
+          }
+        }
+      }
+      continue;
+    }
+    int type = std::find(loadgen_types, loadgen_types + LOADGEN_TYPES, r.type) - loadgen_types;
+    for (int t = type; ; t = LOADGEN_TYPES) {
+      latencies[t].push_back(r.latency_ns);
+      errors[t] += !r.ok;
+      if (t == LOADGEN_TYPES) {
+        break;
+      }
+    }
+  }
+  double seconds = start != 0 ? (wall_now_ns() - start) / 1e9 : 0;
+  for (size_t i = 0; i < clients.size(); i++) {
+    waitpid(clients[i], NULL, 0);
+  }
+  if (ready < o.clients) {
+    fprintf(stderr, "loadgen: only %d of %d clients started\n", ready, o.clients);
+    return 1;
+  }
+
+  if (o.json) {
+    printf("[\n");
+  } else {
+    printf("type,requests,errors,per_s,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n");
+  }
+  for (int t = 0; t < LOADGEN_TYPES; t++) {
+    char name[2] = { loadgen_types[t], '\0' };
+    report(name, latencies[t], errors[t], seconds, o.json, t == 0);
+  }
+  report("all", latencies[LOADGEN_TYPES], errors[LOADGEN_TYPES], seconds, o.json, false);
+  if (o.json) {
+    printf("\n]\n");
+  }
+  return 0;
+}
@@ -0,0 +1,325 @@
+/*
+ * Interrupt driven sampling of the joystick, buttons and potentiometer.
+ */
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+
+#include "input.h"
+
+// Buttons, in the order of their events in input_type_t starting at
+// INPUT_CLICK.  All of them read LOW when pressed.
+static const uint8_t button_pins[] = {
+  JOY_SEL, selectButton, solveButton, checkButton
+};
+#define NBUTTONS (sizeof(button_pins) / sizeof(button_pins[0]))
+
+// Debounced state of each button (1 = pressed) and how many samples in a
+// row the raw reading has disagreed with it.
+static uint8_t button_state[NBUTTONS];
+static uint8_t button_count[NBUTTONS];
+
+// Direction the joystick is held in, as an input_type_t, or 0xFF if it is
+// centred, and the samples left until the move repeats.
+#define JOY_CENTRED 0xFF
+static uint8_t joy_dir = JOY_CENTRED;
+static uint8_t joy_count = 0;
+
+// Analog channels scanned by the ADC, and the latest averaged reading of
+// each one.  Joystick readings are on the usual 0-1023 scale; the
+// potentiometer keeps the extra resolution from oversampling, 0-4095.
+static const uint8_t adc_channels[] = {
+  JOY_VERT_ANALOG, JOY_HORIZ_ANALOG, potentPin
+};
+#define NCHANNELS (sizeof(adc_channels) / sizeof(adc_channels[0]))
+#define ADC_POT 2
+static volatile uint16_t adc_value[NCHANNELS] = { JOY_CENTRE, JOY_CENTRE, 0 };
+
+#ifdef __AVR__
+// Channel being converted, its running sum and how many conversions are
+// in it.  A negative count marks conversions to throw away.
+static uint8_t adc_index = 0;
+static uint16_t adc_sum = 0;
+static int8_t adc_count = 0;
+#endif
+
+// Digit the potentiometer points at, whether the ADC has read it yet, and
+// the last digit turned into an event (0 before the first reading).
+static volatile uint8_t pot_digit = 1;
+static volatile bool pot_read = false;
+static uint8_t pot_reported = 0;
+
+// An event has been made since input_begin()
+static volatile bool touched = false;
+
+// Ring of events.  Only the interrupt writes head and only the main loop
+// writes tail, and each is a single byte, so no locking is needed.  The
+// slots themselves are not volatile, so a barrier keeps the compiler from
+// moving a slot's store past the head that publishes it, or its load
+// ahead of the head read or past the tail that frees it.
+#define QUEUE_BARRIER() asm volatile("" ::: "memory")
+static input_event_t queue[INPUT_QUEUE_SIZE];
+static volatile uint8_t queue_head = 0;
+static volatile uint8_t queue_tail = 0;
+
+#ifndef __AVR__
+// Event names for the host's latency report
+static const char *const input_names[] = {
+  "up", "down", "left", "right", "click", "select", "solve", "check", "pot"
+};
+#endif
+
+// Ring of recorded changes, shared the same way as the events, and the
+// raw inputs as last recorded.  A fresh recording records everything.
+static input_change_t record_queue[INPUT_RECORD_SIZE];
+static volatile uint8_t record_head = 0;
+static volatile uint8_t record_tail = 0;
+static volatile bool record_on = false;
+static volatile bool record_fresh = false;
+static uint8_t record_buttons[NBUTTONS];
+static uint16_t record_analog[NCHANNELS];
+
+static void push_event(uint8_t type, uint8_t value) {
+  touched = true;
+  uint8_t next = (queue_head + 1) & (INPUT_QUEUE_SIZE - 1);
+  if (next == queue_tail) {
+    return; // queue is full, drop the event
+  }
+  queue[queue_head].type = type;
+  queue[queue_head].value = value;
+  QUEUE_BARRIER();
+  queue_head = next;
+#ifndef __AVR__
+  host_input_event(input_names[type]);
+#endif
+}
+
+static void push_change(uint32_t ms, uint8_t pin, uint16_t value) {
+  uint8_t next = (record_head + 1) & (INPUT_RECORD_SIZE - 1);
+  if (next == record_tail) {
+    return; // queue is full, drop the change
+  }
+  record_queue[record_head].ms = ms;
+  record_queue[record_head].pin = pin;
+  record_queue[record_head].value = value;
+  QUEUE_BARRIER();
+  record_head = next;
+}
+
+/* Records whatever raw input changed since it was last recorded.  The
+ * state a fresh recording starts with is timed 0, as that of start up.
+ */
+static void record_sample(const uint8_t levels[NBUTTONS]) {
+  bool all = record_fresh;
+  record_fresh = false;
+  uint32_t ms = all ? 0 : millis();
+  for (uint8_t i = 0; i < NBUTTONS; i++) {
+    if (all || levels[i] != record_buttons[i]) {
+      record_buttons[i] = levels[i];
+      push_change(ms, button_pins[i], levels[i]);
+    }
+  }
+  for (uint8_t i = 0; i < NCHANNELS; i++) {
+    // The potentiometer is kept at 0-4095; record it on the usual scale
+    uint16_t value = i == ADC_POT ? adc_value[i] / 4 : adc_value[i];
+    if (all || abs((int) value - (int) record_analog[i]) >= INPUT_RECORD_STEP) {
+      record_analog[i] = value;
+      push_change(ms, A0 + adc_channels[i], value);
+    }
+  }
+}
+
+void input_begin() {
+  for (uint8_t i = 0; i < NBUTTONS; i++) {
+    pinMode(button_pins[i], INPUT);
+    digitalWrite(button_pins[i], HIGH); // enable the pull up
+  }
+
+#ifdef __AVR__
+  noInterrupts();
+
+  // ADC free running from AVcc, prescaler 128: 125 kHz ADC clock, about
+  // 9600 conversions per second shared between the channels.
+  ADMUX = _BV(REFS0) | adc_channels[0];
+  ADCSRB = 0;
+  ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE)
+         | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+
+  // Timer2 in CTC mode, prescaler 1024: 16 MHz / 1024 / 156 = 100 Hz
+  TCCR2A = _BV(WGM21);
+  TCCR2B = _BV(CS22) | _BV(CS21) | _BV(CS20);
+  OCR2A = (F_CPU / 1024) * INPUT_SAMPLE_MS / 1000 - 1;
+  TCNT2 = 0;
+  TIMSK2 = _BV(OCIE2A);
+  interrupts();
+#else
+  // Off target the host core calls the sampler on the same schedule
+  host_every(INPUT_SAMPLE_MS * 1000UL, input_sample);
+#endif
+}
+
+#ifdef __AVR__
+ISR(TIMER2_COMPA_vect) {
+  input_sample();
+}
+#endif
+
+/* Works out the potentiometer digit from a 0-4095 reading.  The digit only
+ * changes once the reading is INPUT_POT_HYSTERESIS past the edge of the
+ * current digit's band.
+ */
+static uint8_t pot_to_digit(uint16_t value, uint8_t digit) {
+  int16_t lo = (int16_t) ((uint32_t) (digit - 1) * 4096 / 9) - INPUT_POT_HYSTERESIS;
+  int16_t hi = (int16_t) ((uint32_t) digit * 4096 / 9) + INPUT_POT_HYSTERESIS;
+  if ((int16_t) value >= lo && (int16_t) value < hi) {
+    return digit;
+  }
+  return 1 + (uint32_t) value * 9 / 4096;
+}
+
+#ifdef __AVR__
+ISR(ADC_vect) {
+  uint16_t value = ADC;
+
+  // In free running mode the next conversion has already started when
+  // this interrupt runs, so the one after a channel switch still reads
+  // the old channel and is skipped.
+  if (adc_count < 0) {
+    adc_count++;
+    return;
+  }
+
+  adc_sum += value;
+  if (++adc_count < INPUT_OVERSAMPLE) {
+    return;
+  }
+
+  if (adc_index == ADC_POT) {
+    // Averaging 4x fewer samples than were summed keeps 2 extra bits
+    uint16_t pot = adc_sum / (INPUT_OVERSAMPLE / 4);
+    adc_value[adc_index] = pot;
+    pot_digit = pot_to_digit(pot, pot_digit);
+    pot_read = true;
+  } else {
+    adc_value[adc_index] = adc_sum / INPUT_OVERSAMPLE;
+  }
+
+  // Move on to the next channel
+  if (++adc_index == NCHANNELS) {
+    adc_index = 0;
+  }
+  ADMUX = _BV(REFS0) | adc_channels[adc_index];
+  adc_sum = 0;
+  adc_count = -1;
+}
+#else
+/* Stands in for the ADC scan off target, where there is no ADC to leave
+ * running: reads each channel once per sample instead.
+ */
+static void adc_scan() {
+  adc_value[0] = analogRead(adc_channels[0]);
+  adc_value[1] = analogRead(adc_channels[1]);
+  adc_value[ADC_POT] = analogRead(adc_channels[ADC_POT]) * 4;
+  pot_digit = pot_to_digit(adc_value[ADC_POT], pot_digit);
+  pot_read = true;
+}
+#endif
+
+void input_sample() {
+#ifndef __AVR__
+  adc_scan();
+#endif
+
+  // Buttons: a change is only accepted once it has been seen for
+  // INPUT_DEBOUNCE samples in a row.
+  uint8_t levels[NBUTTONS];
+  for (uint8_t i = 0; i < NBUTTONS; i++) {
+    levels[i] = digitalRead(button_pins[i]);
+    uint8_t pressed = levels[i] == LOW;
+    if (pressed == button_state[i]) {
+      button_count[i] = 0;
+    } else if (++button_count[i] >= INPUT_DEBOUNCE) {
+      button_state[i] = pressed;
+      button_count[i] = 0;
+      if (pressed) {
+        push_event(INPUT_CLICK + i, 0);
+      }
+    }
+  }
+
+  // Joystick: vertical movement wins over horizontal.  If the joystick
+  // is up or left, the reading is smaller.
+  int vert = adc_value[0];
+  int horiz = adc_value[1];
+  uint8_t dir = JOY_CENTRED;
+  if (abs(vert - JOY_CENTRE) > JOY_DEADZONE) {
+    dir = vert < JOY_CENTRE ? INPUT_UP : INPUT_DOWN;
+  } else if (abs(horiz - JOY_CENTRE) > JOY_DEADZONE) {
+    dir = horiz < JOY_CENTRE ? INPUT_LEFT : INPUT_RIGHT;
+  }
+  if (dir != joy_dir) {
+    joy_dir = dir;
+    if (dir != JOY_CENTRED) {
+      push_event(dir, 0);
+      joy_count = INPUT_REPEAT_DELAY;
+    }
+  } else if (dir != JOY_CENTRED && --joy_count == 0) {
+    push_event(dir, 0);
+    joy_count = INPUT_REPEAT_PERIOD;
+  }
+
+  // Potentiometer: the ADC interrupt keeps the digit up to date.  Where
+  // it points at start up is not a turn, so the first reading is no event.
+  if (pot_read && pot_digit != pot_reported) {
+    bool turned = pot_reported != 0;
+    pot_reported = pot_digit;
+    if (turned) {
+      push_event(INPUT_POT, pot_reported);
+    }
+  }
+
+  if (record_on) {
+    record_sample(levels);
+  }
+}
+
+bool input_poll(input_event_t *ev) {
+  uint8_t tail = queue_tail;
+  if (tail == queue_head) {
+    return false;
+  }
+  QUEUE_BARRIER();
+  *ev = queue[tail];
+  QUEUE_BARRIER();
+  queue_tail = (tail + 1) & (INPUT_QUEUE_SIZE - 1);
+  return true;
+}
+
+void input_flush() {
+  queue_tail = queue_head;
+}
+
+uint8_t input_pot_digit() {
+  return pot_digit;
+}
+
+bool input_untouched() {
+  return !touched;
+}
+
+void input_record(bool on) {
+  record_fresh = on;
+  record_on = on;
+}
+
+bool input_record_poll(input_change_t *c) {
+  uint8_t tail = record_tail;
+  if (tail == record_head) {
+    return false;
+  }
+  QUEUE_BARRIER();
+  *c = record_queue[tail];
+  QUEUE_BARRIER();
+  record_tail = (tail + 1) & (INPUT_RECORD_SIZE - 1);
+  return true;
+}
@@ -0,0 +1,114 @@
+/*
+ * Interrupt driven sampling of the joystick, buttons and potentiometer.
+ *
+ * A timer interrupt samples every input at a fixed rate, debounces the
+ * buttons, turns joystick deflections into moves (repeating while held)
+ * and pushes the resulting events onto a queue.  The main loop takes
+ * events off the queue with input_poll() whenever it gets to it, so no
+ * press is missed however long drawing or serial traffic takes.
+ *
+ * The analog inputs are never read with analogRead().  The ADC runs free,
+ * scanning the joystick and potentiometer channels from its own
+ * interrupt and averaging INPUT_OVERSAMPLE conversions per channel, so
+ * the CPU never waits for a conversion.
+ *
+ * The raw inputs can also be recorded as they change, to replay a session
+ * on the host build (see host/include/host.h, HOST_INPUT).
+ */
+
+#ifndef _INPUT_H
+#define _INPUT_H
+
+#include <stdint.h>
+
+#define JOY_SEL  9 // Pin 9 responds to clicking the joystick.
+#define JOY_VERT_ANALOG 0 // Pin A0 responds to vertical joystick movement.
+#define JOY_HORIZ_ANALOG 1 // Pin A1 responds to horizontal joystick movement.
+#define JOY_DEADZONE 64 // Only care if position is JOY_CENTRE +/- JOY_DEADZONE.
+#define JOY_CENTRE 512 // The centre value for the joystick.
+
+#define potentPin 2 // potentiometer pin used for difficulty
+#define selectButton 22 //for selection of numbers
+#define solveButton 23 //for solving
+#define checkButton 24 //for solving
+
+#define INPUT_SAMPLE_MS 10 // Time between two samples of the inputs.
+#define INPUT_DEBOUNCE 3 // Samples a button must be steady before it counts.
+#define INPUT_REPEAT_DELAY 40 // Samples a direction is held before repeating.
+#define INPUT_REPEAT_PERIOD 15 // Samples between repeats after that.
+#define INPUT_QUEUE_SIZE 16 // Must be a power of 2.
+#define INPUT_OVERSAMPLE 16 // Conversions averaged per analog reading.
+// How far (out of 4096) the potentiometer must go past the edge of a
+// digit's band before the digit changes, so it doesn't flicker between
+// two neighbouring digits.
+#define INPUT_POT_HYSTERESIS 48
+#define INPUT_RECORD_SIZE 16 // Recorded changes held; must be a power of 2.
+// How far (out of 1023) an analog input must move before the change is
+// recorded.
+#define INPUT_RECORD_STEP 4
+
+typedef enum {
+  INPUT_UP,      // joystick pushed up
+  INPUT_DOWN,    // joystick pushed down
+  INPUT_LEFT,    // joystick pushed left
+  INPUT_RIGHT,   // joystick pushed right
+  INPUT_CLICK,   // joystick pressed in
+  INPUT_SELECT,  // select button pressed
+  INPUT_SOLVE,   // solve button pressed
+  INPUT_CHECK,   // check button pressed
+  INPUT_POT      // potentiometer moved to a new digit, given in value
+} input_type_t;
+
+typedef struct {
+  uint8_t type;   // an input_type_t
+  uint8_t value;  // digit 1-9 for INPUT_POT, unused otherwise
+} input_event_t;
+
+typedef struct {
+  uint32_t ms;     // millis() when the change was sampled
+  uint8_t pin;     // digital pin, or A0 + channel for an analog input
+  uint16_t value;  // level of a digital pin, 0-1023 for an analog one
+} input_change_t;
+
+/* Sets up the input pins and starts the sampling interrupt. */
+void input_begin();
+
+/* Takes the oldest event off the queue.
+ *
+ * Returns false, leaving ev untouched, if no event is waiting.
+ */
+bool input_poll(input_event_t *ev);
+
+/* Throws away every waiting event, eg. after a long blocking operation
+ * during which the user kept pressing buttons.
+ */
+void input_flush();
+
+/* Returns the digit (1-9) the potentiometer currently points at.  Never
+ * waits for the ADC.
+ */
+uint8_t input_pot_digit();
+
+/* Returns true while no event has been made since input_begin(), so the
+ * inputs are as they were at start up, as far as the sketch can tell.
+ */
+bool input_untouched();
+
+/* Starts or stops recording the raw inputs.  A recording starts with the
+ * state of every input, timed 0 as the state since start up, then holds
+ * each change as it is sampled.  Start it only while input_untouched().
+ */
+void input_record(bool on);
+
+/* Takes the oldest recorded change off the queue.
+ *
+ * Returns false, leaving c untouched, if there is none.  Changes that do
+ * not fit in the queue are lost, so take them at least every
+ * INPUT_RECORD_SIZE samples while the inputs are moving.
+ */
+bool input_record_poll(input_change_t *c);
+
+/* Takes one sample of every input.  Called from the timer interrupt. */
+void input_sample();
+
+#endif
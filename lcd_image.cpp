@@ -8,6 +8,40 @@
 #include <SD.h>
 
 #include "lcd_image.h"
+#include "profile.h"
+#include "trace.h"
+
+// The image kept open by lcd_image_open(), and its file
+static lcd_image_t *open_img = NULL;
+static File open_file;
+
+/* Opens the referenced image ahead of drawing it, and keeps it open.
+ *
+ * Finding the file on the card walks the directory and the FAT, which is
+ * a good part of the cost of drawing a full screen image; doing it early,
+ * while nothing else is going on, makes the later draw that much faster.
+ * The first block of the image is read as well, so it is waiting in the
+ * card's block cache.  Only one image is kept open at a time.
+ *
+ * img : the image to open
+ *
+ * Returns false if the file could not be opened.
+ */
+bool lcd_image_open(lcd_image_t *img) {
+  if (open_img == img) {
+    return true;
+  }
+  if (open_img != NULL) {
+    open_file.close();
+    open_img = NULL;
+  }
+  if (!(open_file = SD.open(img->file_name))) {
+    return false;
+  }
+  open_img = img;
+  open_file.read();
+  return true;
+}
 
 /* Draws the referenced image to the LCD screen.
  *
@@ -22,10 +56,16 @@ void lcd_image_draw(lcd_image_t *img, Adafruit_ST7735 *tft,
 		    uint16_t scol, uint16_t srow, 
 		    uint16_t width, uint16_t height)
 {
+  PROFILE_SECTION("lcd_image_draw");
+  TRACE_SCOPE("lcd_image_draw");
   File file;
+  bool kept = (img == open_img);
 
   // Open requested file on SD card if not already open
-  if ((file = SD.open(img->file_name)) == NULL) {
+  if (kept) {
+    file = open_file;
+  }
+  else if ((file = SD.open(img->file_name)) == NULL) {
     Serial.print("File not found:'");
     Serial.print(img->file_name);
     Serial.println('\'');
@@ -46,7 +86,9 @@ void lcd_image_draw(lcd_image_t *img, Adafruit_ST7735 *tft,
     // Read row of pixels
     if (file.read((uint8_t *) pixels, 2 * width) != 2 * width) {
       Serial.println("SD Card Read Error!");
-      file.close();
+      if (!kept) {
+        file.close();
+      }
       return;
     }
     
@@ -60,6 +102,8 @@ void lcd_image_draw(lcd_image_t *img, Adafruit_ST7735 *tft,
     }
   }
 
-  file.close();
+  if (!kept) {
+    file.close();
+  }
 }
 
@@ -11,6 +11,12 @@ typedef struct {
   uint16_t nrows;
 } lcd_image_t;
 
+/* Opens the referenced image ahead of drawing it, and keeps it open so
+ * that lcd_image_draw() does not have to find it on the card again.
+ * Returns false if the file could not be opened.
+ */
+bool lcd_image_open(lcd_image_t *img);
+
 /* Draws the referenced image to the LCD screen.
  *
  * img           : the image to draw
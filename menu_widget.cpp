@@ -0,0 +1,83 @@
+/*
+ * Table driven menus for the LCD display.
+ */
+
+#include <Arduino.h>
+
+#include "menu_widget.h"
+#include "profile.h"
+#include "trace.h"
+
+static void menu_draw_item(Adafruit_ST7735 *tft, const menu_t *menu, int8_t i) {
+  const menu_item_t *item = &menu->items[i];
+
+  if (!item->selectable) {
+    tft->setTextColor(item->colour, ST7735_BLACK);
+  } else if (i == menu->selection) { // Highlighted
+    tft->setTextColor(ST7735_BLACK, ST7735_WHITE);
+  } else { // Not highlighted
+    tft->setTextColor(ST7735_WHITE, ST7735_BLACK);
+  }
+  tft->setTextSize(item->size);
+  tft->setCursor(item->x, item->y);
+  tft->print(item->text);
+}
+
+/* Returns the next selectable item after (step > 0) or before (step < 0)
+ * item i, wrapping around.  Returns i if there is no other one.
+ */
+static int8_t menu_next(const menu_t *menu, int8_t i, int8_t step) {
+  int8_t start = i;
+  do {
+    i += step;
+    if (i < 0) {
+      i = menu->nitems - 1;
+    } else if (i >= menu->nitems) {
+      i = 0;
+    }
+  } while (!menu->items[i].selectable && i != start);
+  return i;
+}
+
+void menu_show(Adafruit_ST7735 *tft, menu_t *menu, const menu_t *previous) {
+  PROFILE_SECTION("menu_show");
+  TRACE_SCOPE("menu_show");
+  if (previous == NULL) {
+    tft->fillScreen(ST7735_BLACK);
+  } else {
+    // Only clear where the old menu drew text
+    for (uint8_t i = 0; i < previous->nitems; i++) {
+      const menu_item_t *item = &previous->items[i];
+      tft->fillRect(item->x, item->y, strlen(item->text) * 6 * item->size,
+                    8 * item->size, ST7735_BLACK);
+    }
+  }
+  tft->setTextWrap(false);
+
+  // Start on a selectable item
+  if (!menu->items[menu->selection].selectable) {
+    menu->selection = menu_next(menu, menu->selection, 1);
+  }
+
+  for (uint8_t i = 0; i < menu->nitems; i++) {
+    menu_draw_item(tft, menu, i);
+  }
+}
+
+bool menu_move(Adafruit_ST7735 *tft, menu_t *menu, int8_t delta) {
+  if (delta == 0) {
+    return false;
+  }
+
+  int8_t old_selection = menu->selection;
+  int8_t i = menu_next(menu, old_selection, delta > 0 ? 1 : -1);
+  if (i == old_selection) {
+    return false;
+  }
+  menu->selection = i;
+
+  // Repaint just the two items whose highlight changed
+  menu_draw_item(tft, menu, old_selection);
+  menu_draw_item(tft, menu, i);
+  return true;
+}
@@ -0,0 +1,47 @@
+/*
+ * Table driven menus for the LCD display.
+ *
+ * A menu is a table of items, each with its text, position, size and
+ * colour.  Titles are drawn once; selectable items are drawn white on
+ * black, or black on white when highlighted.  Moving the highlight only
+ * repaints the item that lost it and the item that gained it.
+ */
+
+#ifndef _MENU_WIDGET_H
+#define _MENU_WIDGET_H
+
+#include <Adafruit_GFX.h>    // Core graphics library
+#include <Adafruit_ST7735.h> // Hardware-specific library
+
+typedef struct {
+  const char *text;
+  uint8_t x, y;       // upper-left corner of the text
+  uint8_t size;       // text size (1, 2, ...)
+  uint16_t colour;    // text colour of titles, unused for selectable items
+  bool selectable;
+} menu_item_t;
+
+typedef struct {
+  const menu_item_t *items;
+  uint8_t nitems;
+  int8_t selection;   // index of the highlighted item
+} menu_t;
+
+/* Draws a whole menu.
+ *
+ * tft      : the initialized tft struct
+ * menu     : the menu to draw
+ * previous : the menu currently on screen, whose items are erased instead
+ *            of clearing the whole screen, or NULL if something else is
+ *            being shown
+ */
+void menu_show(Adafruit_ST7735 *tft, menu_t *menu, const menu_t *previous);
+
+/* Moves the highlight to the next (delta > 0) or previous (delta < 0)
+ * selectable item, wrapping around.
+ *
+ * Returns true if the highlight moved.
+ */
+bool menu_move(Adafruit_ST7735 *tft, menu_t *menu, int8_t delta);
+
+#endif
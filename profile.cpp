@@ -0,0 +1,79 @@
+/*
+ * Named section profiler.
+ */
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+
+#include "profile.h"
+#include "dprintf.h"
+
+// Sections timed so far
+static profile_section_t *profile_list = NULL;
+
+#ifdef __AVR__
+// Upper 16 bits of the tick count
+static volatile uint16_t profile_overflows = 0;
+
+ISR(TIMER1_OVF_vect) {
+  profile_overflows++;
+}
+
+void profile_begin() {
+  noInterrupts();
+  // Timer1 free running in normal mode, prescaler 8: 2 MHz
+  TCCR1A = 0;
+  TCCR1B = _BV(CS11);
+  TCNT1 = 0;
+  TIFR1 = _BV(TOV1);
+  TIMSK1 = _BV(TOIE1);
+  interrupts();
+}
+
+uint32_t profile_ticks() {
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t low = TCNT1;
+  uint16_t high = profile_overflows;
+  // An overflow that happened since interrupts went off has not been
+  // counted yet; if the low half has already wrapped, count it here.
+  if ((TIFR1 & _BV(TOV1)) && low < 0x8000) {
+    high++;
+  }
+  SREG = sreg;
+  return ((uint32_t) high << 16) | low;
+}
+#else
+void profile_begin() {
+}
+
+uint32_t profile_ticks() {
+  return host_now_ns() / (1000 / PROFILE_TICKS_PER_US);
+}
+#endif
+
+void profile_record(profile_section_t *section, uint32_t ticks) {
+  if (!section->listed) {
+    section->next = profile_list;
+    section->listed = true;
+    profile_list = section;
+  }
+  section->calls++;
+  section->total_ticks += ticks;
+  if (ticks < section->min_ticks) {
+    section->min_ticks = ticks;
+  }
+  if (ticks > section->max_ticks) {
+    section->max_ticks = ticks;
+  }
+}
+
+void profile_dump() {
+  dprintf("prof section calls total_us min_us max_us");
+  for (profile_section_t *s = profile_list; s != NULL; s = s->next) {
+    dprintf("prof %s %lu %lu %lu %lu", s->name, (unsigned long) s->calls,
+            (unsigned long) (s->total_ticks / PROFILE_TICKS_PER_US),
+            (unsigned long) (s->min_ticks / PROFILE_TICKS_PER_US),
+            (unsigned long) (s->max_ticks / PROFILE_TICKS_PER_US));
+  }
+}
@@ -0,0 +1,83 @@
+/*
+ * Named section profiler.
+ *
+ * PROFILE_SECTION("name") at the top of a block times the rest of the
+ * block, every time it runs.  Each section keeps its call count and its
+ * total, shortest and longest time in a static record at the point of
+ * use, so nothing is allocated and an unused section costs nothing.
+ * Records join a list the first time they are timed; profile_dump()
+ * prints that list with dprintf.
+ *
+ * On the Mega, time is counted in Timer1 ticks of 0.5 us, extended to 32
+ * bits by the overflow interrupt.  In the host build it comes from the
+ * host clock, so on the virtual clock sections show the time they would
+ * take on the Mega.
+ *
+ * Remove the PROFILE_ENABLE define below, or build with PROFILE_OFF
+ * defined, to compile every section out.
+ */
+
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#undef PROFILE_ENABLE
+#ifndef PROFILE_OFF
+#define PROFILE_ENABLE
+#endif
+
+#ifdef __AVR__
+#define PROFILE_TICKS_PER_US 2
+#else
+#define PROFILE_TICKS_PER_US 10
+#endif
+
+typedef struct profile_section {
+  const char *name;
+  struct profile_section *next;  // sections timed so far, newest first
+  bool listed;                   // in the list yet
+  uint32_t calls;
+  uint32_t min_ticks;
+  uint32_t max_ticks;
+  uint64_t total_ticks;
+} profile_section_t;
+
+/* Starts the tick counter.  Call once from setup(). */
+void profile_begin();
+
+/* Current time in ticks; wraps around, so only differences count. */
+uint32_t profile_ticks();
+
+/* Adds one run of a section, ticks long. */
+void profile_record(profile_section_t *section, uint32_t ticks);
+
+/* Prints every section timed so far: calls, total, min and max in us. */
+void profile_dump();
+
+/* Times its own lifetime; used by PROFILE_SECTION. */
+class ProfileScope {
+public:
+  ProfileScope(profile_section_t *section)
+    : section(section), start(profile_ticks()) {}
+  ~ProfileScope() { profile_record(section, profile_ticks() - start); }
+private:
+  profile_section_t *section;
+  uint32_t start;
+};
+
+#define PROFILE_CAT2(a, b) a##b
+#define PROFILE_CAT(a, b) PROFILE_CAT2(a, b)
+
+#ifdef PROFILE_ENABLE
+#define PROFILE_SECTION(name) \
+  static profile_section_t PROFILE_CAT(profile_section_, __LINE__) = \
+    { name, NULL, false, 0, 0xFFFFFFFF, 0, 0 }; \
+  ProfileScope PROFILE_CAT(profile_scope_, __LINE__)( \
+    &PROFILE_CAT(profile_section_, __LINE__))
+#else
+#define PROFILE_SECTION(name)
+#endif
+
+#endif
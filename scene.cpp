@@ -0,0 +1,139 @@
+/*
+ * Retained drawing of the game screen.
+ */
+
+#include <Arduino.h>
+
+#include "scene.h"
+#include "profile.h"
+#include "trace.h"
+
+// Shadow value for a region whose contents on screen are unknown.
+#define SCENE_UNKNOWN 0xFF
+
+static Adafruit_ST7735 *scene_tft;
+static scene_look_fn scene_look;
+
+// What each cell shows right now, as SCENE_LOOK()
+static uint8_t shown_cells[81];
+// One bit per cell that needs its look recomputed
+static uint8_t dirty_cells[11];
+
+// What the status fields show right now
+static uint8_t shown_row = SCENE_UNKNOWN;
+static uint8_t shown_col = SCENE_UNKNOWN;
+static uint8_t shown_label = SCENE_UNKNOWN;
+// What they should show
+static uint8_t status_row;
+static uint8_t status_col;
+static uint8_t status_label;
+
+static unsigned long last_flush = 0;
+
+void scene_init(Adafruit_ST7735 *tft, scene_look_fn look) {
+  scene_tft = tft;
+  scene_look = look;
+  scene_invalidate();
+}
+
+void scene_invalidate() {
+  memset(shown_cells, SCENE_UNKNOWN, sizeof(shown_cells));
+  shown_row = SCENE_UNKNOWN;
+  shown_col = SCENE_UNKNOWN;
+  shown_label = SCENE_UNKNOWN;
+  scene_mark_all();
+}
+
+void scene_mark(uint8_t square) {
+  dirty_cells[square >> 3] |= 1 << (square & 7);
+}
+
+void scene_mark_peers(uint8_t square) {
+  uint8_t r = square / 9;
+  uint8_t c = square % 9;
+  uint8_t br = r - r % 3;
+  uint8_t bc = c - c % 3;
+  for (uint8_t i = 0; i < 9; i++) {
+    scene_mark(r*9 + i);
+    scene_mark(i*9 + c);
+    scene_mark((br + i / 3)*9 + bc + i % 3);
+  }
+}
+
+void scene_mark_all() {
+  memset(dirty_cells, 0xFF, sizeof(dirty_cells));
+}
+
+void scene_set_status(uint8_t row, uint8_t col, scene_label_t label) {
+  status_row = row;
+  status_col = col;
+  status_label = label;
+}
+
+uint8_t scene_flush(bool force) {
+  unsigned long now = millis();
+  if (!force && now - last_flush < SCENE_FRAME_MS) {
+    return 0;
+  }
+  PROFILE_SECTION("scene_flush");
+  TRACE_SCOPE("scene_flush");
+  last_flush = now;
+
+  uint8_t painted = 0;
+
+  for (uint8_t i = 0; i < sizeof(dirty_cells); i++) {
+    uint8_t bits = dirty_cells[i];
+    if (bits == 0) {
+      continue;
+    }
+    dirty_cells[i] = 0;
+    for (uint8_t b = 0; b < 8; b++) {
+      uint8_t square = i*8 + b;
+      if (!(bits & (1 << b)) || square >= 81) {
+        continue;
+      }
+      uint8_t look = scene_look(square);
+      if (look != shown_cells[square]) {
+        glyph_draw_cell(scene_tft, square / 9, square % 9,
+                        SCENE_LOOK_DIGIT(look), SCENE_LOOK_STYLE(look));
+        shown_cells[square] = look;
+        painted++;
+      }
+    }
+  }
+
+  if (status_label != shown_label) {
+    scene_tft->setTextSize(1);
+    scene_tft->setCursor(75, 130);
+    switch (status_label) {
+      case SCENE_CURRENT:
+      scene_tft->setTextColor(0xFFE0, ST7735_BLACK);
+      scene_tft->print("Current:");
+      break;
+
+      case SCENE_SETTING:
+      scene_tft->setTextColor(0xF800, ST7735_BLACK);
+      scene_tft->print("SETTING:");
+      break;
+
+      case SCENE_INVALID:
+      scene_tft->setTextColor(0xF800, ST7735_BLACK);
+      scene_tft->print("Invalid:");
+      break;
+    }
+    shown_label = status_label;
+    painted++;
+  }
+
+  if (status_row != shown_row || status_col != shown_col) {
+    scene_tft->setTextSize(1);
+    scene_tft->setTextColor(0xFFE0, ST7735_BLACK);
+    scene_tft->setCursor(95, 140);
+    scene_tft->print(status_row); scene_tft->print(" "); scene_tft->print(status_col);
+    shown_row = status_row;
+    shown_col = status_col;
+    painted++;
+  }
+
+  return painted;
+}
@@ -0,0 +1,69 @@
+/*
+ * Retained drawing of the game screen.
+ *
+ * The scene keeps a shadow copy of what every board cell and status field
+ * currently shows on the LCD, plus a set of cells that may have changed.
+ * Input and protocol code only mark cells dirty; scene_flush() then works
+ * out what each dirty cell should look like and repaints just the ones that
+ * differ from the shadow.  When nothing changes nothing is sent to the
+ * display.
+ */
+
+#ifndef _SCENE_H
+#define _SCENE_H
+
+#include <Adafruit_GFX.h>    // Core graphics library
+#include <Adafruit_ST7735.h> // Hardware-specific library
+
+#include "glyph_tiles.h"
+
+// Minimum time between two flushes, in milliseconds.
+#define SCENE_FRAME_MS 20
+
+// Packs a cell's digit and tile style into the one byte kept in the shadow.
+#define SCENE_LOOK(digit, style) ((uint8_t) ((digit) | ((style) << 4)))
+#define SCENE_LOOK_DIGIT(look)   ((look) & 0x0F)
+#define SCENE_LOOK_STYLE(look)   ((glyph_style_t) ((look) >> 4))
+
+// Labels of the status field below the board
+typedef enum {
+  SCENE_CURRENT,  // moving around the board
+  SCENE_SETTING,  // entering a value with the potentiometer
+  SCENE_INVALID   // the board as filled in has no solution
+} scene_label_t;
+
+/* Computes how a board cell (0-80) should currently look, as SCENE_LOOK(). */
+typedef uint8_t (*scene_look_fn)(uint8_t square);
+
+/* Sets the display and the function used to compute cell looks. */
+void scene_init(Adafruit_ST7735 *tft, scene_look_fn look);
+
+/* Forgets the shadow copy, eg. after the background image was redrawn,
+ * so the next flush repaints every cell and status field.
+ */
+void scene_invalidate();
+
+/* Marks one cell (0-80) as possibly changed. */
+void scene_mark(uint8_t square);
+
+/* Marks a cell and every cell sharing its row, column or box.  Used after
+ * a value change, since it can add or clear conflicts in all of them.
+ */
+void scene_mark_peers(uint8_t square);
+
+/* Marks every cell as possibly changed. */
+void scene_mark_all();
+
+/* Sets the status fields below the board: the cursor coordinates and
+ * the label above them.  Only redrawn when they change.
+ */
+void scene_set_status(uint8_t row, uint8_t col, scene_label_t label);
+
+/* Repaints the dirty cells and status fields whose look changed.  Does
+ * nothing if called again within SCENE_FRAME_MS unless force is set.
+ *
+ * Returns the number of regions that were repainted.
+ */
+uint8_t scene_flush(bool force = false);
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * Cooperative task scheduler.
+ */
+
+#include <Arduino.h>
+
+#include "sched.h"
+#include "dprintf.h"
+
+static task_t *sched_tasks;
+static uint8_t sched_ntasks;
+
+// When the running task's budget is used up, in micros()
+static unsigned long sched_deadline;
+
+// Start of the current statistics period, in micros()
+static unsigned long sched_since;
+
+void sched_begin(task_t *tasks, uint8_t ntasks) {
+  sched_tasks = tasks;
+  sched_ntasks = ntasks;
+
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < ntasks; i++) {
+    task_t *t = &tasks[i];
+    t->next_run = now + t->period_ms;
+    t->signalled = false;
+    t->runs = t->overruns = t->total_us = t->max_us = 0;
+  }
+  sched_since = micros();
+}
+
+void sched_signal(uint8_t task) {
+  sched_tasks[task].signalled = true;
+}
+
+bool sched_time_left() {
+  return (long) (sched_deadline - micros()) > 0;
+}
+
+void sched_run() {
+  for (uint8_t i = 0; i < sched_ntasks; i++) {
+    task_t *t = &sched_tasks[i];
+
+    if (t->signalled) {
+      t->signalled = false;
+    } else if (t->period_ms != 0 && (long) (millis() - t->next_run) >= 0) {
+      t->next_run += t->period_ms;
+      // Don't try to catch up on runs missed while something else ran long
+      if ((long) (millis() - t->next_run) >= 0) {
+        t->next_run = millis() + t->period_ms;
+      }
+    } else {
+      continue;
+    }
+
+    unsigned long start = micros();
+    sched_deadline = start + t->budget_us;
+    t->fn();
+    uint32_t took = micros() - start;
+
+    t->runs++;
+    t->total_us += took;
+    if (took > t->max_us) {
+      t->max_us = took;
+    }
+    if (took > t->budget_us) {
+      t->overruns++;
+    }
+  }
+}
+
+void sched_report() {
+  uint32_t elapsed = micros() - sched_since;
+  uint32_t busy = 0;
+
+  for (uint8_t i = 0; i < sched_ntasks; i++) {
+    task_t *t = &sched_tasks[i];
+    // share of the processor in tenths of a percent
+    uint16_t share = (uint64_t) t->total_us * 1000 / elapsed;
+    dprintf("task %s runs %lu over %lu max %luus cpu %u.%u%%", t->name,
+            (unsigned long) t->runs, (unsigned long) t->overruns,
+            (unsigned long) t->max_us, share / 10, share % 10);
+    busy += t->total_us;
+    t->runs = t->overruns = t->total_us = t->max_us = 0;
+  }
+  uint16_t idle = (uint64_t) (elapsed - busy) * 1000 / elapsed;
+  dprintf("idle cpu %u.%u%%", idle / 10, idle % 10);
+
+  sched_since = micros();
+}
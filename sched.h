@@ -0,0 +1,56 @@
+/*
+ * Cooperative task scheduler.
+ *
+ * Tasks are plain functions listed in a table, in priority order.  A task
+ * either runs every period_ms, or (period_ms = 0) only after something
+ * called sched_signal() for it.  Tasks must return quickly: each one has
+ * a time budget it is expected to stay within, and runs that go over it
+ * are counted as overruns.  Long jobs split themselves into slices, using
+ * sched_time_left() to know when to stop, and signal themselves to run
+ * again.
+ *
+ * The scheduler keeps per task statistics so sched_report() can show
+ * where the processor's time goes.
+ */
+
+#ifndef _SCHED_H
+#define _SCHED_H
+
+#include <stdint.h>
+
+typedef void (*task_fn_t)(void);
+
+typedef struct {
+  const char *name;
+  task_fn_t fn;
+  uint16_t period_ms;   // run every period_ms, or 0 to run only when signalled
+  uint16_t budget_us;   // how long one run is expected to take at most
+
+  // Filled in by the scheduler
+  unsigned long next_run;   // millis() when a periodic task is due
+  volatile bool signalled;  // an event task has been asked to run
+  uint32_t runs;            // number of runs
+  uint32_t overruns;        // runs that took longer than budget_us
+  uint32_t total_us;        // time spent in all runs
+  uint32_t max_us;          // longest run
+} task_t;
+
+/* Starts scheduling the given table of tasks. */
+void sched_begin(task_t *tasks, uint8_t ntasks);
+
+/* Asks for an event driven task (or a periodic one, early) to run. */
+void sched_signal(uint8_t task);
+
+/* Runs every task that is due once, highest priority first. */
+void sched_run();
+
+/* Returns true while the task that is running is within its budget. */
+bool sched_time_left();
+
+/* Prints each task's run count, overruns, longest run and share of the
+ * processor since the last report, using dprintf, then starts counting
+ * afresh.
+ */
+void sched_report();
+
+#endif
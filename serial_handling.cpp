@@ -4,310 +4,373 @@
 #include <errno.h>
 //#include <assert13.h>
 #include "dprintf.h"
+#include "profile.h"
+#include "trace.h"
+
+// How long to wait for each line of a reply from the server, in ms. There
+// is no limit on waiting for the server to finish solving or generating.
+#define PROTO_LINE_TIMEOUT 1000
+
+// Where the current request is in the protocol
+enum {
+    ST_IDLE,             // nothing started yet
+    ST_SEND_CELLS,       // sending the board, one cell per 'A' received
+    ST_SEND_DIFFICULTY,  // sending the difficulty on the 'A' received
+    ST_WAIT_DONE,        // waiting for the server's 'D' (or '-' on error)
+    ST_WAIT_RESULT,      // waiting for the result of a check
+    ST_RECV_CELLS,       // receiving the board, sending 'A' for each cell
+    ST_WAIT_END,         // waiting for the closing 'E'
+    ST_DONE,
+    ST_ERROR
+};
+
+static uint8_t proto_state = ST_IDLE;
+static char proto_request;         // 'C', 'F' or 'G'
+static int (*proto_board)[9];      // board sent and/or received
+static uint8_t proto_difficulty;
+static uint8_t proto_cell;         // next cell to send or receive
+static int8_t proto_value;         // result of a check
+
+static const char *proto_name;     // of the request, for the trace
+
+static bool proto_timed;           // proto_deadline applies
+static unsigned long proto_deadline;
+
+// Called for lines from the server outside of a request
+static void (*proto_command)(const char *line) = NULL;
+
+// Called for every line from the server, before it is acted on
+static void (*proto_received)(const char *line) = NULL;
+
+// Line being received
+static char proto_line[32];
+static uint8_t proto_len;
 
 /*
-    Gets an acknowledgment whether the sudoku board is solved or not.
-
-    The function sends a request to the server listening on the serial
-    port and waits for the server responding with a boolean representing
-    whether the board was correctly solved or incorrectly solved.
-
-    Inputs:
-
-    board(*)[9] - the current sudoku board waiting to be verified
-
-    Returns:
+    Starts a request and sends its first line.
+*/
+static void proto_begin(char request, int board[9][9]) {
+    proto_request = request;
+    proto_board = board;
+    proto_cell = 0;
+    proto_value = -1;
+    proto_len = 0;
+    proto_state = (request == 'G') ? ST_SEND_DIFFICULTY : ST_SEND_CELLS;
+    proto_timed = true;
+    proto_deadline = millis() + PROTO_LINE_TIMEOUT;
+    proto_name = (request == 'C') ? "check" : (request == 'F') ? "solve" : "generate";
+    TRACE(TRACE_ASYNC_BEGIN, proto_name);
+    dprintf("Requesting %c", request);
+    Serial.println(request);
+}
 
-    1 if the board is correct, 0 if the board is incorrect
+/*
+    Sends a line and restarts the timeout for the reply.
+*/
+static void proto_send(int value, bool timed) {
+    TRACE(TRACE_INSTANT, "send");
+    Serial.println(value);
+    proto_timed = timed;
+    proto_deadline = millis() + PROTO_LINE_TIMEOUT;
+}
 
+/*
+    Moves the request along for one complete line received from the
+    server.
 */
-bool check_board(int board[9][9]) {
-    size_t buf_size = 32;
-    size_t buf_len = 0;
-    char buf[buf_size];
-    int32_t t = 0;
-    int16_t path_len = 0;
-    uint8_t j = 0;
-    uint8_t k = 0;
-    int check;
-
-    // start the server communication with a check request
-    delay(1000);
-    dprintf("Requesting board check");
-    Serial.println("C");  // Send server check request
-    while (1) {
-        buf_len = serial_readline_timed(buf, buf_size, 1000);
-        if ((int) buf_len < 0){
-            return -1;  // If timeout return error message
-        }
-        sscanf(buf,"%c", buf[0]);
-        dprintf("%d %d", j, k);
-        dprintf("first loop %c",buf[0]);
-
-        if (k == 9){
-            k = 0;
-            if (j==8){
-                break;
-            }
-            else{
-                j += 1;
-            }
-        }
-        if (buf[0] == 'A') {  // if acknowledgment was recieved, send the next cell to server
-            dprintf("sending %d",board[j][k]);
-            Serial.println(board[j][k]);
-            k+=1;
+static void proto_handle_line(const char *line) {
+    // The server can ask for the profile or the trace at any time
+    if (line[0] == 'P') {
+        profile_dump();
+        return;
+    }
+    if (line[0] == 'T') {
+        trace_flush_serial();
+        return;
+    }
+    if (line[0] == 'S') {  // trace to the SD card instead
+        if (!trace_flush_file("TRACE.TXT")) {
+            dprintf("Cannot write TRACE.TXT");
         }
+        return;
     }
 
+    switch (proto_state) {
+        case ST_SEND_CELLS:
+        if (line[0] == 'A') {  // if acknowledgment was recieved, send the next cell
+            proto_send(proto_board[proto_cell / 9][proto_cell % 9], proto_cell < 80);
+            if (++proto_cell == 81) {
+                proto_state = ST_WAIT_DONE;
+            }
+        }
+        break;
 
+        case ST_SEND_DIFFICULTY:
+        if (line[0] == 'A') {  // if acknowledgment was recieved, send the difficulty
+            proto_send(proto_difficulty, false);
+            proto_state = ST_WAIT_DONE;
+        }
+        break;
+
+        case ST_WAIT_DONE:
+        if (line[0] == 'D') {  // server is done: receive the result or the board
+            proto_timed = true;
+            proto_deadline = millis() + PROTO_LINE_TIMEOUT;
+            if (proto_request == 'C') {
+                proto_state = ST_WAIT_RESULT;
+            } else {
+                proto_cell = 0;
+                proto_state = ST_RECV_CELLS;
+                TRACE(TRACE_INSTANT, "ack");
+                Serial.println('A');  // ask for the first cell
+            }
+        } else if (line[0] == '-') {  // error in solve or generation
+            dprintf("Server error");
+            proto_state = ST_ERROR;
+        }
+        break;
 
-    //delay(1000);
+        case ST_WAIT_RESULT:
+        proto_value = atoi(line);
+        proto_state = ST_DONE;
+        break;
 
-    while (true){
-        ///buf_len = serial_readline_timed(buf, 2, -1);
-        ///dprintf("%s",buf[0]);
-        dprintf("waiting for D"); // Waiting for completion of solve
-        //buf_len = serial_readline_timed(buf, buf_size, -1); // I guess I don't need this?
-        sscanf(buf,"%c", buf[0]);
-        dprintf("%c",buf[0]);
+        case ST_RECV_CELLS:
+        if (line[0] < '0' || line[0] > '9') {
+            dprintf("Bad cell %s", line);
+            proto_state = ST_ERROR;
+            break;
+        }
+        // Conversion of char into int representation
+        proto_board[proto_cell / 9][proto_cell % 9] = line[0] - '0';
+        proto_cell++;
+        // acknowledge; after the last cell this asks for the 'E'
+        TRACE(TRACE_INSTANT, "ack");
+        Serial.println('A');
+        proto_deadline = millis() + PROTO_LINE_TIMEOUT;
+        if (proto_cell == 81) {
+            proto_state = ST_WAIT_END;
+        }
+        break;
 
-        if (buf_len < 0){
-            return buf_len;
+        case ST_WAIT_END:
+        if (line[0] == 'E') {  // end of protocol
+            proto_state = ST_DONE;
+        } else {
+            dprintf("error-solve");  // error in transmission
+            Serial.println(-1);
+            proto_state = ST_ERROR;
         }
+        break;
 
-        if (buf[0] == 'D') {  // if check is complete receive the result
-            dprintf("inside check");
-            buf_len = serial_readline_timed(buf, buf_size, 1000);
-            sscanf(buf,"%d", &check);
-            dprintf("%d",check);
-            break;
+        default:  // no request running: a command for the sketch
+        if (proto_command != NULL) {
+            proto_command(line);
         }
+        break;
     }
-    dprintf("Outside Check");
-    return check;
 }
 
 /*
-    Requests for a current sudoku board to be solved.
+    Starts a request to check whether the board is correctly solved.
 
-    The function sends a request to the server listening on the serial
-    port and waits for the completed board.
+    The board is sent to the server one cell per acknowledgment, and the
+    server answers with 1 if it is solved correctly, 0 if not.  Call
+    proto_pump() until it stops returning PROTO_BUSY, then read the answer
+    with proto_result().
 
     Inputs:
 
-    board(*)[9] - the current sudoku board waiting to be verified
+    board(*)[9] - the current sudoku board waiting to be verified; it must
+        stay untouched until the request is finished
+*/
+void proto_check(int board[9][9]) {
+    proto_begin('C', board);
+}
 
-    Returns:
+/*
+    Starts a request for the board to be solved.
 
-    -1 if an error occurred
-    >= 0 if ok.
+    The board is sent to the server, which sends back the completed board
+    once solved, or '-' if it cannot be solved.  Call proto_pump() until
+    it stops returning PROTO_BUSY.
+
+    Inputs:
 
+    board(*)[9] - the current sudoku board, overwritten with the solution
 */
-int8_t solve_board(int board[9][9]) {
-    dprintf("in solve board");
-    size_t buf_size = 32;
-    size_t buf_len = 0;
-    char buf[buf_size];
-    uint8_t j = 0;
-    uint8_t k = 0;
-    uint8_t jj = 0;
-    uint8_t kk = 0;
-    int16_t path_len = 0;
-    int value = 0;
-    char c[buf_size];
-
-    // start the server communication with a solve request
-    delay(1000);
-    dprintf("Requesting board solve");
-    Serial.println("F");  // send server solve request
-    while (1) {
-        buf_len = serial_readline_timed(buf, buf_size, 1000);
-        if ((int) buf_len < 0){
-            dprintf("error");
-            return -1;  // If timeout return error message
-        }
-        if (k == 9){
-            k = 0;
-            j += 1;
-        }
-        sscanf(buf,"%c", buf[0]);
-        dprintf("%d %d", j, k);
-        dprintf("first loop %c",buf[0]);
-
-        if (buf[0] == 'A') {  // if acknowledgment was recieved, send the next board cell
-            dprintf("sending %d",board[j][k]);
-            Serial.println(board[j][k]);
-            k+=1;
-        }
-        if (k == 9 && j==8){
-            break;
-        }
-    }dprintf("done 1");
+void proto_solve(int board[9][9]) {
+    proto_begin('F', board);
+}
 
-    while (true){
-        dprintf("waiting for D"); // waiting for solve to be completed
-        buf_len = serial_readline_timed(buf, buf_size, -1);
-        sscanf(buf,"%c", buf[0]);
-        dprintf("In second loop %c",buf[0]);
+/*
+    Starts a request for a random board of the given difficulty.  Call
+    proto_pump() until it stops returning PROTO_BUSY.
 
-        if (buf_len < 0){
-            return buf_len;
-        }
+    Inputs:
 
-        if (buf[0] == 'D') {  // if solve is complete, begin receiving the board
-            dprintf("inside");
-            while (1) {
-                Serial.println('A');
-                if (kk == 9 && jj==8){
-                    break;
-                }
+    difficulty - integer representign the difficulty/number of hints
 
-                buf_len = serial_readline_timed(buf, buf_size, 1000);
-                if ((int) buf_len < 0){
-                    return -1;  // If timeout return error message
-                }
-                if (kk == 9){
-                    kk = 0;
-                    jj += 1;
-                }
+    board(*)[9] - overwritten with the generated board
+*/
+void proto_generate(uint8_t difficulty, int board[9][9]) {
+    proto_difficulty = difficulty;
+    proto_begin('G', board);
+}
 
-                value =  buf[0] - '0';  // Conversion of char into int representation
-                dprintf("%d %d", jj, kk);
-                dprintf("second loop %d", value);
+/*
+    Handles whatever the server has sent since the last call, without
+    waiting for more.  Lines that arrive while no request is running are
+    read too, so the server's 'P' is answered between requests.
 
+    Returns:
 
-                board[jj][kk] = value;  // update the board value
-                kk+=1;
-            }
-            buf_len = serial_readline_timed(buf, buf_size, 1000);
-            Serial.read();
-            sscanf(buf,"%c", &c);
-            dprintf("Wait for E: %c", *c);
-            if (*c == 'E') {  // end of protocol
+    the status of the current request
+*/
+proto_status_t proto_pump() {
+    PROFILE_SECTION("proto_pump");
+    bool busy = (proto_status() == PROTO_BUSY);
+    while (Serial.available() > 0) {
+        char c = (char) Serial.read();
 
-                break;
-            }
-            else {
-                dprintf("error-solve"); // error in transmission
-                Serial.println(-1);
-                return -1;
+        // A newline is given by \r or \n, or some combination of both
+        if (c == '\r' || c == '\n' || c == 0) {
+            if (proto_len > 0) {
+                proto_line[proto_len] = '\0';
+                proto_len = 0;
+                if (proto_received != NULL) {
+                    proto_received(proto_line);
+                }
+                proto_handle_line(proto_line);
+                if (busy && proto_status() != PROTO_BUSY) {
+                    TRACE(TRACE_ASYNC_END, proto_name);
+                    busy = false;
+                }
             }
+        } else if (proto_len < sizeof(proto_line) - 1) {
+            proto_line[proto_len++] = c;
         }
-        else if (buf[0] == '-'){  // error in solve
-            dprintf("Unsolvable");
-            return -1;
-        }
-    }dprintf("Outside?");
-    return 0;
+    }
+
+    if (proto_status() == PROTO_BUSY && proto_timed &&
+        (long) (millis() - proto_deadline) > 0) {
+        dprintf("Timeout waiting for server");
+        proto_state = ST_ERROR;
+        TRACE(TRACE_ASYNC_END, proto_name);
+    }
+    return proto_status();
 }
 
 /*
-    Generates a random sudoku board based on inputted difficulty.
+    Sets the function called with each line the server sends while no
+    request is running, other than the ones handled here ('P', 'T', 'S').
 
     Inputs:
 
-    difficulty - integer representign the difficulty/number of hints
+    handler - called with the line, without its newline
+*/
+void proto_on_command(void (*handler)(const char *line)) {
+    proto_command = handler;
+}
 
-    board(*)[9] - the current sudoku board waiting for random configuration
+/*
+    Sets the function called with every line the server sends, requests'
+    lines included, before the line is acted on.
+
+    Inputs:
 
+    handler - called with the line, without its newline
+*/
+void proto_on_receive(void (*handler)(const char *line)) {
+    proto_received = handler;
+}
+
+/*
     Returns:
 
-    -1 if an error occurred
-    >= 0 if ok.
+    the status of the current request, without doing anything
+*/
+proto_status_t proto_status() {
+    switch (proto_state) {
+        case ST_IDLE: return PROTO_IDLE;
+        case ST_DONE: return PROTO_DONE;
+        case ST_ERROR: return PROTO_ERROR;
+        default: return PROTO_BUSY;
+    }
+}
 
+/*
+    Returns:
+
+    the answer to a finished check request: 1 if the board is correct,
+    0 if the board is incorrect
 */
-int8_t gen_board(uint8_t difficulty, int board[9][9]) {
-    dprintf("in gen board");
-    size_t buf_size = 32;
-    size_t buf_len = 0;
-    char buf[buf_size];
-    uint8_t j = 0;
-    uint8_t k = 0;
-    int16_t path_len = 0;
-    int value = 0;
-    char c[buf_size];
-
-    // start the server communication with a solve request
-    delay(1000);
-    dprintf("Requesting random board");
-    Serial.println("G");  // Send a server request to generate a board
-    while (1) {
-        buf_len = serial_readline_timed(buf, buf_size, 1000);
-        if ((int) buf_len < 0){
-            dprintf("error");
-            return -1;  // If timeout return error message
-        }
+int8_t proto_result() {
+    return proto_value;
+}
 
-        sscanf(buf,"%c", buf[0]);
-        dprintf("%d %d", j, k);
-        dprintf("first loop %c", buf[0]);
+/*
+    Gets an acknowledgment whether the sudoku board is solved or not.
+    Blocks until the server has answered.
 
-        if (buf[0] == 'A') {  // if acknowledgment was recieved, send the difficulty to server
-            dprintf("sending %d", difficulty);
-            Serial.println(difficulty);
-            break;
-        }
-    }dprintf("done 1");
+    Inputs:
 
-    //delay(1000);
+    board(*)[9] - the current sudoku board waiting to be verified
 
-    while (true){
+    Returns:
 
-        dprintf("waiting for D"); // waiting for generation to be completed
-        buf_len = serial_readline_timed(buf, buf_size, -1);
-        sscanf(buf,"%c", &c);
-        dprintf("In second loop %c", *c);
+    1 if the board is correct, 0 if the board is incorrect, -1 on error
 
-        if (buf_len < 0){
-            return buf_len;
-        }
+*/
+int8_t check_board(int board[9][9]) {
+    PROFILE_SECTION("check_board");
+    proto_check(board);
+    while (proto_pump() == PROTO_BUSY) {}
+    return proto_status() == PROTO_DONE ? proto_result() : -1;
+}
 
-        if (buf[0] == 'D') {  // if completion reciept is recieved start receiving board
-            dprintf("inside");
-            while (1) {
-                Serial.println('A');
-                if (k == 9 && j==8){
-                    break;
-                }
+/*
+    Requests for a current sudoku board to be solved.  Blocks until the
+    server has answered.
 
-                buf_len = serial_readline_timed(buf, buf_size, 1000);
-                if ((int) buf_len < 0){
-                    return -1;  // If timeout return error message
-                }
-                if (k == 9){
-                    k = 0;
-                    j += 1;
-                }
+    Inputs:
 
-                value =  buf[0] - '0';  // Conversion of char into int representation
-                dprintf("%d %d", j, k);
-                dprintf("second loop %d", value);
+    board(*)[9] - the current sudoku board waiting to be verified
 
+    Returns:
 
-                board[j][k] = value;  // update the board
-                k+=1;
-            }
-            buf_len = serial_readline_timed(buf, buf_size, 1000);
-            Serial.read();
-            sscanf(buf,"%c", &c);
-            dprintf("Wait for E: %c", *c);
-            if (*c == 'E') {  // end of protocol
+    -1 if an error occurred
+    >= 0 if ok.
 
-                break;
-            }
-            else {
-                dprintf("error-solve");  // error in transmission
-                Serial.println(-1);
-                return -1;
-            }
-        }
-        else if (buf[0] == '-'){  // error in generation
-            dprintf("Error in Generation");
-            return -1;
-        }
-    }dprintf("Outside?");
-    return 0;
+*/
+int8_t solve_board(int board[9][9]) {
+    PROFILE_SECTION("solve_board");
+    proto_solve(board);
+    while (proto_pump() == PROTO_BUSY) {}
+    return proto_status() == PROTO_DONE ? 0 : -1;
+}
+
+/*
+    Generates a random sudoku board based on inputted difficulty.  Blocks
+    until the server has answered.
+
+    Inputs:
+
+    difficulty - integer representign the difficulty/number of hints
+
+    board(*)[9] - the current sudoku board waiting for random configuration
+
+    Returns:
+
+    -1 if an error occurred
+    >= 0 if ok.
+
+*/
+int8_t gen_board(uint8_t difficulty, int board[9][9]) {
+    PROFILE_SECTION("gen_board");
+    proto_generate(difficulty, board);
+    while (proto_pump() == PROTO_BUSY) {}
+    return proto_status() == PROTO_DONE ? 0 : -1;
 }
 
 
@@ -357,7 +420,7 @@ int16_t serial_readline_timed(char *line, uint16_t line_size, long timeout) {
         if ( line[bytes_read] == '\r' || line[bytes_read] == '\n' ||
              line[bytes_read] == 0 ) {
                 // We ran into a newline character!  Overwrite it with \0
-                line[bytes_read] == '\0';
+                line[bytes_read] = '\0';
                 break;    // Break out of this - we are done reading a line.
         } else {
             bytes_read++;
@@ -3,11 +3,36 @@
 
 #include <stdint.h>
 
+// Progress of the request started by proto_check(), proto_solve() or
+// proto_generate().
+typedef enum {
+    PROTO_IDLE,   // no request has been started
+    PROTO_BUSY,   // waiting for the server, keep calling proto_pump()
+    PROTO_DONE,   // finished, the board or proto_result() hold the answer
+    PROTO_ERROR   // the server reported an error, or stopped answering
+} proto_status_t;
+
 int16_t serial_readline_timed(char *line, uint16_t line_size, long timeout);
 
 int16_t serial_readline(char *line, uint16_t line_size);
 
-bool check_board(int board[9][9]);
+void proto_check(int board[9][9]);
+
+void proto_solve(int board[9][9]);
+
+void proto_generate(uint8_t difficulty, int board[9][9]);
+
+proto_status_t proto_pump();
+
+void proto_on_command(void (*handler)(const char *line));
+
+void proto_on_receive(void (*handler)(const char *line));
+
+proto_status_t proto_status();
+
+int8_t proto_result();
+
+int8_t check_board(int board[9][9]);
 
 int8_t solve_board(int board[9][9]);
 
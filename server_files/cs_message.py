@@ -1,4 +1,5 @@
 import sys
+import time
 
 """
 client-server messaging facility
@@ -22,6 +23,87 @@ it's own stderr.
 # modify with set_loggin, query with get logging
 logging = True;
 
+# when True every line sent to stderr starts with the time it was printed,
+# in seconds on the monotonic clock.  modify with set_timestamps
+timestamps = False
+
+def set_timestamps(new):
+    """
+    Set timestamps on True, or off False.  trace2json.py uses them to put
+    the server's log and the client's trace on one timeline.
+    Return the previous value.
+    """
+
+    global timestamps
+    old = timestamps
+    timestamps = new
+    return old
+
+# when set, the client's recorded inputs ("D R" messages) are written to
+# this file as a host input script.  modify with set_recording
+recording = None
+
+# the client's time in the last recorded line, the monotonic time it came
+# in, and whether it was the line that ends the recording
+recording_ms = 0
+recording_seen = 0.0
+recording_ended = False
+
+def set_recording(new):
+    """
+    Set the file the client's recorded inputs go to, or None.
+    Return the previous one.
+    """
+
+    global recording, recording_ms, recording_seen, recording_ended
+    old = recording
+    recording = new
+    recording_ms = 0
+    recording_seen = time.monotonic()
+    recording_ended = False
+    return old
+
+def get_recording():
+    return recording
+
+def end_recording():
+    """
+    Close the file the client's recorded inputs go to.  If the client never
+    sent the line that ends the recording, write one, at the client's time
+    now as near as it can be told, so a replay stops there.
+    """
+
+    global recording
+    if recording is None:
+        return
+    if not recording_ended:
+        ms = recording_ms + int((time.monotonic() - recording_seen) * 1000)
+        print("{} end".format(ms), file=recording, flush=True)
+    recording.close()
+    recording = None
+
+def record_line(line):
+    """
+    Write a line of the client's recording to the recording file, keeping
+    track of the client's time.
+    """
+
+    global recording_ms, recording_seen, recording_ended
+    print(line, file=recording, flush=True)
+    fields = line.split()
+    if fields and fields[0].isdigit():
+        recording_ms = int(fields[0])
+        recording_seen = time.monotonic()
+    recording_ended = len(fields) == 2 and fields[1] == "end"
+
+def stamp():
+    """
+    The prefix for a line on stderr: the time, if timestamps are on.
+    """
+    if timestamps:
+        return "{:.6f} ".format(time.monotonic())
+    return ""
+
 def set_logging(new):
     """
     Set logging on True, or off False.  
@@ -57,7 +139,7 @@ def log_msg(msg):
     """
     global logging
     if logging:
-        print("L |{}|".format(escape_nl(msg)), file=sys.stderr, flush=True)
+        print("{}L |{}|".format(stamp(), escape_nl(msg)), file=sys.stderr, flush=True)
 
 def send_msg_to_client(channel, msg):
     """ 
@@ -87,8 +169,10 @@ def receive_msg_from_client(channel):
         # from the client, and should be sent to stderr and ignored.
 
         if msg.strip()[:1] == "D":
+            if recording is not None and msg.startswith("D R "):
+                record_line(msg[4:].strip())
             if logging: 
-                print(escape_nl(msg), file=sys.stderr, flush=True)
+                print(stamp() + escape_nl(msg), file=sys.stderr, flush=True)
             continue
         else:
             break
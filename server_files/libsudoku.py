@@ -0,0 +1,222 @@
+'''
+libsudoku.py
+
+Description: ctypes wrapper around libsudoku.so, the native solver built from
+the libsudoku directory ("make -C server_files/libsudoku").  Boards are lists
+of 81 ints, row by row, 0 for an empty cell, like the server's colour lists.
+
+If the library is not built, or does not match this wrapper, available() is
+False and solver.py falls back on its own Python solver.  Set LIBSUDOKU to
+the path of the library to load a different one, LIBSUDOKU_ENGINE to
+"dlx" to solve with dancing links instead of the bitmask solver, and
+LIBSUDOKU_THREADS to split each search between that many threads (0 for one
+per CPU) so a hard board is solved sooner.
+'''
+
+import ctypes
+import os
+import random
+import sys
+
+ABI_VERSION = 5
+
+Board = ctypes.c_uint8 * 81
+
+# The grader's techniques, easiest first, and its difficulty bands
+TECHNIQUES = ("hidden single", "naked single", "pointing", "claiming",
+              "naked pair", "hidden pair", "naked triple", "hidden triple",
+              "x-wing", "swordfish", "guess")
+Uses = ctypes.c_int * len(TECHNIQUES)
+EASY, MEDIUM, HARD = 0, 1, 2
+
+
+def _load():
+    '''Loads the library and declares its functions.
+
+    Returns:
+        The library, or None if it cannot be loaded.
+    '''
+    here = os.path.dirname(os.path.abspath(__file__))
+    path = os.environ.get("LIBSUDOKU",
+                          os.path.join(here, "libsudoku", "libsudoku.so"))
+    try:
+        lib = ctypes.CDLL(path)
+    except OSError:
+        return None
+
+    lib.sudoku_abi_version.restype = ctypes.c_int
+    lib.sudoku_abi_version.argtypes = []
+    if lib.sudoku_abi_version() != ABI_VERSION:
+        return None
+
+    lib.sudoku_set_engine.restype = ctypes.c_int
+    lib.sudoku_set_engine.argtypes = [ctypes.c_char_p]
+    engine = os.environ.get("LIBSUDOKU_ENGINE")
+    if engine and lib.sudoku_set_engine(engine.encode()) != 0:
+        print("libsudoku: no solver called {}, using bitmask".format(engine),
+              file=sys.stderr)
+    lib.sudoku_set_threads.restype = ctypes.c_int
+    lib.sudoku_set_threads.argtypes = [ctypes.c_int]
+    threads = os.environ.get("LIBSUDOKU_THREADS")
+    if threads:
+        lib.sudoku_set_threads(int(threads))
+
+    lib.sudoku_solve.restype = ctypes.c_int
+    lib.sudoku_solve.argtypes = [Board, Board]
+    lib.sudoku_check.restype = ctypes.c_int
+    lib.sudoku_check.argtypes = [Board]
+    lib.sudoku_count_solutions.restype = ctypes.c_long
+    lib.sudoku_count_solutions.argtypes = [Board, ctypes.c_long]
+    lib.sudoku_generate.restype = ctypes.c_int
+    lib.sudoku_generate.argtypes = [ctypes.c_int, ctypes.c_uint32, Board]
+    lib.sudoku_generate_unique.restype = ctypes.c_int
+    lib.sudoku_generate_unique.argtypes = [
+        ctypes.c_int, ctypes.c_int, ctypes.c_uint32, Board,
+        ctypes.POINTER(ctypes.c_long), ctypes.POINTER(ctypes.c_double)]
+    lib.sudoku_grade.restype = ctypes.c_int
+    lib.sudoku_grade.argtypes = [Board, Uses]
+    lib.sudoku_generate_graded.restype = ctypes.c_int
+    lib.sudoku_generate_graded.argtypes = [
+        ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_uint32, Board,
+        ctypes.POINTER(ctypes.c_long), ctypes.POINTER(ctypes.c_double)]
+    return lib
+
+
+_lib = _load()
+
+
+def available():
+    '''
+    Returns:
+        True if the native solver was loaded.
+    '''
+    return _lib is not None
+
+
+def set_engine(name):
+    '''Chooses the native solver, "bitmask" or "dlx".
+
+    Returns:
+        True, or False if there is no solver by that name.
+    '''
+    return _lib.sudoku_set_engine(name.encode()) == 0
+
+
+def set_threads(threads):
+    '''Splits each search between this many threads (0 for one per CPU, 1
+    to search on the calling thread).
+
+    Returns:
+        The number of threads.
+    '''
+    return _lib.sudoku_set_threads(threads)
+
+
+def solve(cells):
+    '''Solves a board.
+
+    Args:
+        cells(list of int): the board, 0 for empty cells
+
+    Returns:
+        The solved board as a list, or None if it has no solution.
+    '''
+    out = Board()
+    if _lib.sudoku_solve(Board(*cells), out) != 1:
+        return None
+    return list(out)
+
+
+def check(cells):
+    '''
+    Returns:
+        1 if the board is completely and correctly filled in, 0 if not.
+    '''
+    return _lib.sudoku_check(Board(*cells))
+
+
+def count_solutions(cells, limit=0):
+    '''Counts the solutions of a board, stopping at limit (0 for no limit).
+
+    Returns:
+        The number of solutions found.
+    '''
+    return _lib.sudoku_count_solutions(Board(*cells), limit)
+
+
+def generate(hints, seed=None):
+    '''Makes a random board with the given number of hints.
+
+    Args:
+        hints(int): cells left filled in, 0-81
+        seed(int): for a repeatable board; random if None
+
+    Returns:
+        The board as a list.
+    '''
+    if seed is None:
+        seed = random.getrandbits(32)
+    out = Board()
+    _lib.sudoku_generate(hints, seed, out)
+    return list(out)
+
+
+def generate_unique(hints, symmetric=False, seed=None):
+    '''Makes a random board with exactly one solution, emptying cells of a
+    solved board one at a time while it stays unique.
+
+    Args:
+        hints(int): the hints to stop at, 0-81; 0 for a minimal board
+        symmetric(bool): empty cells in pairs opposite each other
+        seed(int): for a repeatable board; random if None
+
+    Returns:
+        (board, solver_calls, seconds): the board as a list, which has more
+        hints than asked for if it became minimal first, the uniqueness
+        checks made and the time it took.
+    '''
+    if seed is None:
+        seed = random.getrandbits(32)
+    out = Board()
+    calls = ctypes.c_long()
+    seconds = ctypes.c_double()
+    _lib.sudoku_generate_unique(hints, int(symmetric), seed, out,
+                                ctypes.byref(calls), ctypes.byref(seconds))
+    return list(out), calls.value, seconds.value
+
+
+def grade(cells):
+    '''Grades a board by the techniques a person would need to solve it.
+
+    Returns:
+        (rating, uses): the rating, 100 times the level of the hardest
+        technique (1-11, see TECHNIQUES) plus up to 99 for the harder steps,
+        and a dict of the steps taken with each technique used; or None if
+        the board does not have exactly one solution.
+    '''
+    uses = Uses()
+    rating = _lib.sudoku_grade(Board(*cells), uses)
+    if rating < 0:
+        return None
+    return rating, {name: n for name, n in zip(TECHNIQUES, uses) if n}
+
+
+def generate_graded(hints, band, symmetric=False, seed=None):
+    '''As generate_unique(), making boards until one is graded in band.
+
+    Args:
+        band(int): EASY (singles only), MEDIUM (locked candidates and
+            subsets) or HARD (fish or guessing)
+
+    Returns:
+        (board, rating, solver_calls, seconds), for all the boards made.
+    '''
+    if seed is None:
+        seed = random.getrandbits(32)
+    out = Board()
+    calls = ctypes.c_long()
+    seconds = ctypes.c_double()
+    rating = _lib.sudoku_generate_graded(hints, band, int(symmetric), seed, out,
+                                         ctypes.byref(calls),
+                                         ctypes.byref(seconds))
+    return list(out), rating, calls.value, seconds.value
@@ -0,0 +1,154 @@
+/*
+ * Solution counter for uniqueness checks.
+ */
+
+#include <string.h>
+
+#include "counter.h"
+#include "units.h"
+
+typedef struct {
+  uint8_t cells[81];   // 0 for an empty cell
+  uint16_t cand[81];   // candidates of the empty cells
+  int empty;
+} counter_board_t;
+
+typedef struct {
+  long limit;
+  long count;
+  uint64_t nodes;
+  uint8_t *out;
+} counter_search_t;
+
+/* Puts digit d in an empty cell and takes it from the peers' candidates.
+ *
+ * Returns false if that leaves a peer with no candidates, or a peer
+ * already holds d.
+ */
+static bool place(counter_board_t *b, int cell, uint8_t d) {
+  uint16_t bit = 1 << (d - 1);
+  b->cells[cell] = d;
+  b->cand[cell] = 0;
+  b->empty--;
+  for (int k = 0; k < 20; k++) {
+    int p = board_peers[cell][k];
+    if (b->cells[p] == d) {
+      return false;
+    }
+    if (b->cells[p] == 0 && (b->cand[p] &= ~bit) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Places naked and hidden singles until there are none left.
+ *
+ * Returns false if the board turns out to have no solution.
+ */
+static bool propagate(counter_board_t *b) {
+  bool progress;
+  do {
+    progress = false;
+    for (int c = 0; c < 81; c++) {
+      uint16_t m = b->cand[c];
+      if (b->cells[c] == 0 && (m & (m - 1)) == 0) {
+        if (!place(b, c, __builtin_ctz(m) + 1)) {
+          return false;
+        }
+        progress = true;
+      }
+    }
+
+    for (int u = 0; u < 27; u++) {
+      const uint8_t *unit = board_units[u];
+      uint16_t once = 0, twice = 0, placed = 0;
+      for (int k = 0; k < 9; k++) {
+        int c = unit[k];
+        if (b->cells[c] != 0) {
+          placed |= 1 << (b->cells[c] - 1);
+        } else {
+          twice |= once & b->cand[c];
+          once |= b->cand[c];
+        }
+      }
+      if ((once | placed) != ALL_DIGITS) {
+        return false;  // a digit with nowhere to go
+      }
+
+      uint16_t hidden = once & ~twice & ~placed;
+      while (hidden != 0) {
+        uint16_t bit = hidden & -hidden;
+        hidden &= hidden - 1;
+        int k = 0;
+        while (k < 9 && !(b->cells[unit[k]] == 0 && (b->cand[unit[k]] & bit))) {
+          k++;
+        }
+        if (k == 9 || !place(b, unit[k], __builtin_ctz(bit) + 1)) {
+          return false;  // its one place went to another hidden single
+        }
+        progress = true;
+      }
+    }
+  } while (progress && b->empty > 0);
+  return true;
+}
+
+/* Returns true once the limit is reached. */
+static bool search(counter_search_t *x, counter_board_t *b) {
+  if (!propagate(b)) {
+    return false;
+  }
+  if (b->empty == 0) {
+    if (++x->count == 1 && x->out != NULL) {
+      memcpy(x->out, b->cells, 81);
+    }
+    return x->count == x->limit;
+  }
+
+  int best = -1, best_count = 10;
+  for (int c = 0; c < 81 && best_count > 2; c++) {
+    if (b->cells[c] == 0) {
+      int count = __builtin_popcount(b->cand[c]);
+      if (count < best_count) {
+        best = c;
+        best_count = count;
+      }
+    }
+  }
+
+  uint16_t cand = b->cand[best];
+  while (cand != 0) {
+    uint8_t d = __builtin_ctz(cand) + 1;
+    cand &= cand - 1;
+    x->nodes++;
+    counter_board_t child = *b;
+    if (place(&child, best, d) && search(x, &child)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+long counter_count(const uint8_t cells[81], long limit, uint8_t out[81], uint64_t *nodes) {
+  counter_board_t b;
+  memset(b.cells, 0, sizeof(b.cells));
+  for (int c = 0; c < 81; c++) {
+    b.cand[c] = ALL_DIGITS;
+  }
+  b.empty = 81;
+  for (int c = 0; c < 81; c++) {
+    if (cells[c] != 0 && !place(&b, c, cells[c])) {
+      return 0;  // the givens clash
+    }
+  }
+
+  counter_search_t x;
+  x.limit = limit;
+  x.count = 0;
+  x.nodes = 0;
+  x.out = out;
+  search(&x, &b);
+  *nodes += x.nodes;
+  return x.count;
+}
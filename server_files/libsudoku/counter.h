@@ -0,0 +1,27 @@
+/*
+ * Solution counter for uniqueness checks.
+ *
+ * Counting has to search the whole tree (up to the limit), not just the
+ * way to the first solution, so before every branch the board is filled
+ * in as far as naked singles (a cell with one candidate) and hidden
+ * singles (a digit with one place in a row, column or box) go, which cuts
+ * the tree down to a few nodes for most boards.  The branch is then on
+ * the cell with the fewest candidates, on a copy of the board, so going
+ * back needs no undoing.  The generator asks "is this unique" hundreds of
+ * times for each board it makes, with a limit of 2.
+ */
+
+#ifndef COUNTER_H
+#define COUNTER_H
+
+#include <stdint.h>
+
+/* Counts the solutions of cells, stopping as soon as limit are found (0
+ * for no limit).  The first solution is written to out if it is not NULL;
+ * the branches tried are added to *nodes.
+ *
+ * Returns the number of solutions found.
+ */
+long counter_count(const uint8_t cells[81], long limit, uint8_t out[81], uint64_t *nodes);
+
+#endif
@@ -0,0 +1,223 @@
+/*
+ * Dancing links solver.
+ */
+
+#include <stddef.h>
+
+#include "dlx.h"
+#include "engine.h"
+
+#define DLX_COLUMNS 324
+#define DLX_ROWS 729
+#define DLX_ROOT 0
+#define DLX_NODES (1 + DLX_COLUMNS + DLX_ROWS * 4)
+#define DLX_STOP_CHECK 256  // rows tried between looks at the stop flag
+
+typedef struct {
+  uint16_t left[DLX_NODES];
+  uint16_t right[DLX_NODES];
+  uint16_t up[DLX_NODES];
+  uint16_t down[DLX_NODES];
+  uint16_t column[DLX_NODES];      // header of the column a node is in
+  uint16_t size[1 + DLX_COLUMNS];  // rows left in each column
+  bool built;
+} dlx_grid_t;
+
+typedef struct {
+  dlx_grid_t *g;
+  long limit;
+  long count;
+  uint64_t nodes;
+  uint8_t *out;
+  const std::atomic<bool> *stop;
+  bool stopped;
+  int depth;
+  uint16_t chosen[81];  // row taken at each depth
+} dlx_search_t;
+
+/* The first node of a row; a row is cell * 9 + digit - 1. */
+static inline uint16_t row_node(int row) {
+  return 1 + DLX_COLUMNS + row * 4;
+}
+
+static inline int node_row(uint16_t node) {
+  return (node - 1 - DLX_COLUMNS) / 4;
+}
+
+/* Builds the full grid, with every row in. */
+static void build(dlx_grid_t *g) {
+  for (int c = 0; c <= DLX_COLUMNS; c++) {
+    g->left[c] = c == 0 ? DLX_COLUMNS : c - 1;
+    g->right[c] = c == DLX_COLUMNS ? 0 : c + 1;
+    g->up[c] = g->down[c] = g->column[c] = c;
+    g->size[c] = 0;
+  }
+
+  for (int row = 0; row < DLX_ROWS; row++) {
+    int cell = row / 9, d = row % 9;
+    int r = cell / 9, c = cell % 9, b = (r / 3) * 3 + c / 3;
+    uint16_t columns[4] = {
+      (uint16_t) (1 + cell),
+      (uint16_t) (1 + 81 + r * 9 + d),
+      (uint16_t) (1 + 162 + c * 9 + d),
+      (uint16_t) (1 + 243 + b * 9 + d),
+    };
+    uint16_t first = row_node(row);
+    for (int k = 0; k < 4; k++) {
+      uint16_t n = first + k, col = columns[k];
+      g->left[n] = k == 0 ? first + 3 : n - 1;
+      g->right[n] = k == 3 ? first : n + 1;
+      g->column[n] = col;
+      g->up[n] = g->up[col];
+      g->down[n] = col;
+      g->down[g->up[col]] = n;
+      g->up[col] = n;
+      g->size[col]++;
+    }
+  }
+  g->built = true;
+}
+
+/* Takes a column out of the header list, and its rows out of the grid. */
+static inline void cover(dlx_grid_t *g, uint16_t col) {
+  g->right[g->left[col]] = g->right[col];
+  g->left[g->right[col]] = g->left[col];
+  for (uint16_t i = g->down[col]; i != col; i = g->down[i]) {
+    for (uint16_t j = g->right[i]; j != i; j = g->right[j]) {
+      g->down[g->up[j]] = g->down[j];
+      g->up[g->down[j]] = g->up[j];
+      g->size[g->column[j]]--;
+    }
+  }
+}
+
+/* Undoes cover(), in the reverse order. */
+static inline void uncover(dlx_grid_t *g, uint16_t col) {
+  for (uint16_t i = g->up[col]; i != col; i = g->up[i]) {
+    for (uint16_t j = g->left[i]; j != i; j = g->left[j]) {
+      g->size[g->column[j]]++;
+      g->down[g->up[j]] = j;
+      g->up[g->down[j]] = j;
+    }
+  }
+  g->right[g->left[col]] = col;
+  g->left[g->right[col]] = col;
+}
+
+/* Covers every column of a row, taking it into the solution. */
+static inline void take_row(dlx_grid_t *g, uint16_t node) {
+  cover(g, g->column[node]);
+  for (uint16_t j = g->right[node]; j != node; j = g->right[j]) {
+    cover(g, g->column[j]);
+  }
+}
+
+static inline void drop_row(dlx_grid_t *g, uint16_t node) {
+  for (uint16_t j = g->left[node]; j != node; j = g->left[j]) {
+    uncover(g, g->column[j]);
+  }
+  uncover(g, g->column[node]);
+}
+
+/* Algorithm X.  Returns true once the limit is reached; the grid is put
+ * back as it was either way.
+ */
+static bool search(dlx_search_t *x) {
+  dlx_grid_t *g = x->g;
+  if (g->right[DLX_ROOT] == DLX_ROOT) {
+    if (++x->count == 1 && x->out != NULL) {
+      for (int i = 0; i < x->depth; i++) {
+        int row = node_row(x->chosen[i]);
+        x->out[row / 9] = row % 9 + 1;
+      }
+    }
+    return x->count == x->limit;
+  }
+
+  // The column with the fewest rows left
+  uint16_t best = g->right[DLX_ROOT];
+  for (uint16_t c = g->right[best]; c != DLX_ROOT; c = g->right[c]) {
+    if (g->size[c] < g->size[best]) {
+      best = c;
+      if (g->size[c] <= 1) {
+        break;
+      }
+    }
+  }
+  if (g->size[best] == 0) {
+    return false;
+  }
+
+  bool done = false;
+  cover(g, best);
+  for (uint16_t r = g->down[best]; r != best && !done; r = g->down[r]) {
+    if (++x->nodes % DLX_STOP_CHECK == 0 && x->stop != NULL && *x->stop) {
+      x->stopped = true;
+      done = true;  // unwinds like reaching the limit
+      break;
+    }
+    x->chosen[x->depth++] = r;
+    for (uint16_t j = g->right[r]; j != r; j = g->right[j]) {
+      cover(g, g->column[j]);
+    }
+    done = search(x);
+    for (uint16_t j = g->left[r]; j != r; j = g->left[j]) {
+      uncover(g, g->column[j]);
+    }
+    x->depth--;
+  }
+  uncover(g, best);
+  return done;
+}
+
+/* Returns false if a digit is repeated in a row, column or box, which the
+ * grid cannot show once the givens are covered.
+ */
+static bool givens_fit(const uint8_t cells[81]) {
+  uint16_t rows[9], cols[9], boxes[9];
+  return engine_givens(cells, rows, cols, boxes);
+}
+
+long dlx_solve(const uint8_t cells[81], uint8_t out[81], long limit, uint64_t *nodes,
+               const std::atomic<bool> *stop) {
+  if (!givens_fit(cells)) {
+    return 0;
+  }
+  static thread_local dlx_grid_t grid;
+  if (!grid.built) {
+    build(&grid);
+  }
+
+  dlx_search_t x;
+  x.g = &grid;
+  x.limit = limit;
+  x.count = 0;
+  x.nodes = 0;
+  x.out = out;
+  x.stop = stop;
+  x.stopped = false;
+  x.depth = 0;
+
+  uint8_t givens[81];
+  int n_givens = 0;
+  for (int i = 0; i < 81; i++) {
+    if (cells[i] != 0) {
+      givens[n_givens++] = i;
+      take_row(&grid, row_node(i * 9 + cells[i] - 1));
+    }
+  }
+  if (out != NULL && out != cells) {
+    for (int i = 0; i < 81; i++) {
+      out[i] = cells[i];
+    }
+  }
+
+  search(&x);
+
+  for (int k = n_givens - 1; k >= 0; k--) {
+    int i = givens[k];
+    drop_row(&grid, row_node(i * 9 + cells[i] - 1));
+  }
+  *nodes += x.nodes;
+  return x.stopped ? -1 : x.count;
+}
@@ -0,0 +1,32 @@
+/*
+ * Dancing links solver.
+ *
+ * Sudoku as an exact cover problem: 729 rows, one for each digit in each
+ * cell, and 324 columns, one for each cell, and for each digit in each
+ * row, column and box.  Algorithm X picks a column with the fewest rows
+ * left, tries each of its rows in turn, and takes out the columns a row
+ * covers along with every row that clashes with it, by unlinking them
+ * from a doubly linked grid (the "dancing links").
+ *
+ * The grid is an arena of fixed arrays built once per thread; each board
+ * covers its givens and the search puts everything back when it is done,
+ * so nothing is allocated or copied per board.
+ */
+
+#ifndef DLX_H
+#define DLX_H
+
+#include <atomic>
+#include <stdint.h>
+
+/* Counts the solutions of cells, stopping once limit are found (0 for no
+ * limit).  The first solution found is written to out, if out is not
+ * NULL; the rows the search tried are added to *nodes.  If stop is given,
+ * the search gives up soon after *stop is set.
+ *
+ * Returns the number of solutions found, or -1 if it gave up.
+ */
+long dlx_solve(const uint8_t cells[81], uint8_t out[81], long limit, uint64_t *nodes,
+               const std::atomic<bool> *stop = NULL);
+
+#endif
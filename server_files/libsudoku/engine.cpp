@@ -0,0 +1,89 @@
+/*
+ * The solving engine behind libsudoku and the batch solver.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "engine.h"
+#include "counter.h"
+#include "dlx.h"
+
+static const char *const engine_names[] = { "bitmask", "dlx" };
+
+static engine_kind_t engine_kind = ENGINE_BITMASK;
+
+void engine_select(engine_kind_t kind) {
+  engine_kind = kind;
+}
+
+bool engine_select_name(const char *name) {
+  for (int k = 0; k < (int) (sizeof(engine_names) / sizeof(engine_names[0])); k++) {
+    if (strcmp(name, engine_names[k]) == 0) {
+      engine_select((engine_kind_t) k);
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *engine_name(void) {
+  return engine_names[engine_kind];
+}
+
+/* Runs the search until it finishes. */
+static solver_status_t run_to_end(board_solver_t *s) {
+  solver_status_t status;
+  do {
+    status = board_solver_run(s, 0xFFFF);
+  } while (status == SOLVER_RUNNING);
+  return status;
+}
+
+solver_status_t engine_solve(const uint8_t cells[81], uint8_t out[81], uint64_t *nodes) {
+  if (engine_kind == ENGINE_DLX) {
+    return dlx_solve(cells, out, 1, nodes) == 1 ? SOLVER_SOLVED : SOLVER_UNSOLVABLE;
+  }
+  board_solver_t s;
+  board_solver_begin(&s, cells);
+  solver_status_t status = run_to_end(&s);
+  *nodes += s.nodes;
+  if (status == SOLVER_SOLVED) {
+    memcpy(out, s.cells, 81);
+  }
+  return status;
+}
+
+long engine_count(const uint8_t cells[81], long limit, uint64_t *nodes) {
+  if (engine_kind == ENGINE_DLX) {
+    return dlx_solve(cells, NULL, limit, nodes);
+  }
+  return counter_count(cells, limit, NULL, nodes);
+}
+
+bool engine_givens(const uint8_t cells[81], uint16_t rows[9], uint16_t cols[9],
+                   uint16_t boxes[9]) {
+  memset(rows, 0, 9 * sizeof(rows[0]));
+  memset(cols, 0, 9 * sizeof(cols[0]));
+  memset(boxes, 0, 9 * sizeof(boxes[0]));
+  for (int i = 0; i < 81; i++) {
+    if (cells[i] == 0) {
+      continue;
+    }
+    int r = i / 9, c = i % 9, b = (r / 3) * 3 + c / 3;
+    uint16_t bit = 1 << (cells[i] - 1);
+    if ((rows[r] | cols[c] | boxes[b]) & bit) {
+      return false;
+    }
+    rows[r] |= bit;
+    cols[c] |= bit;
+    boxes[b] |= bit;
+  }
+  return true;
+}
+
+double engine_seconds(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
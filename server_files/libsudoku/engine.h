@@ -0,0 +1,62 @@
+/*
+ * The solving engine behind libsudoku and the batch solver.
+ *
+ * Boards are 81 bytes, row by row, 0 for an empty cell.  Callers check
+ * that every cell is 0-9 first.
+ *
+ * Two solvers are behind it, chosen with engine_select(): the Arduino's
+ * board_solver.cpp, with candidates kept as bitmasks (the default), and
+ * the dancing links solver in dlx.cpp.  Counting with the bitmask engine
+ * uses counter.cpp, which fills in singles before every branch.
+ */
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdint.h>
+
+#include "board_solver.h"
+
+typedef enum {
+  ENGINE_BITMASK,  // board_solver.cpp
+  ENGINE_DLX       // dlx.cpp
+} engine_kind_t;
+
+/* Chooses the solver used from then on, by all threads. */
+void engine_select(engine_kind_t kind);
+
+/* Chooses a solver by name, "bitmask" or "dlx".
+ *
+ * Returns false, choosing nothing, if there is no solver by that name.
+ */
+bool engine_select_name(const char *name);
+
+/* The name of the solver in use. */
+const char *engine_name(void);
+
+/* Solves cells into out (which may be cells), adding the cells the search
+ * filled in to *nodes.
+ *
+ * Returns SOLVER_SOLVED or SOLVER_UNSOLVABLE.
+ */
+solver_status_t engine_solve(const uint8_t cells[81], uint8_t out[81], uint64_t *nodes);
+
+/* Counts the solutions of cells, stopping once limit are found (0 for no
+ * limit), adding the search's branches to *nodes.  A limit of 2 tells
+ * whether a board has one solution.
+ */
+long engine_count(const uint8_t cells[81], long limit, uint64_t *nodes);
+
+/* Collects the digits given in each row, column and box of cells into
+ * rows, cols and boxes, as bitmasks with bit d - 1 for digit d.
+ *
+ * Returns false, with the masks only part filled, if a digit is repeated
+ * in a row, column or box.
+ */
+bool engine_givens(const uint8_t cells[81], uint16_t rows[9], uint16_t cols[9],
+                   uint16_t boxes[9]);
+
+/* Seconds on a monotonic clock, for timing boards. */
+double engine_seconds(void);
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * Puzzle generator: boards with exactly one solution.
+ */
+
+#include <stddef.h>
+
+#include "generator.h"
+#include "engine.h"
+
+/* Small fast generator for the random boards (xorshift32). */
+static uint32_t next_random(uint32_t *state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return *state = x;
+}
+
+uint32_t gen_random_below(uint32_t *state, uint32_t n) {
+  return (uint32_t) (((uint64_t) next_random(state) * n) >> 32);
+}
+
+static void shuffle(uint32_t *state, uint8_t *a, int n) {
+  for (int i = n - 1; i > 0; i--) {
+    int j = gen_random_below(state, i + 1);
+    uint8_t t = a[i];
+    a[i] = a[j];
+    a[j] = t;
+  }
+}
+
+/* Solved boards to start from, made once with the search.  The
+ * transforms never leave a board's class, so a few classes are mixed in.
+ */
+static const char *const seed_grids[] = {
+  "813627594749358261526419387365194872972835146481762935138276459654981723297543618",
+  "642951378519783426378246915983567241126894537457312689261479853735628194894135762",
+  "149367852578192634326485971463271589912856743785934216257613498834729165691548327",
+  "395124876247683591816795342683571924952846713174239658461958237528317469739462185",
+};
+#define SEED_GRIDS (int) (sizeof(seed_grids) / sizeof(seed_grids[0]))
+
+/* A random order for the rows (or columns) that keeps each band of three
+ * together: the bands shuffled, and the rows within each band.
+ */
+static void shuffle_lines(uint32_t *state, uint8_t lines[9]) {
+  uint8_t bands[3] = { 0, 1, 2 };
+  shuffle(state, bands, 3);
+  for (int b = 0; b < 3; b++) {
+    uint8_t within[3] = { 0, 1, 2 };
+    shuffle(state, within, 3);
+    for (int i = 0; i < 3; i++) {
+      lines[b * 3 + i] = bands[b] * 3 + within[i];
+    }
+  }
+}
+
+void gen_solved(uint32_t *state, uint8_t out[81]) {
+  const char *seed = seed_grids[gen_random_below(state, SEED_GRIDS)];
+  uint8_t rows[9], cols[9];
+  shuffle_lines(state, rows);
+  shuffle_lines(state, cols);
+  uint8_t relabel[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  shuffle(state, relabel + 1, 9);
+  bool transpose = gen_random_below(state, 2) != 0;
+
+  for (int r = 0; r < 9; r++) {
+    for (int c = 0; c < 9; c++) {
+      int from = transpose ? cols[c] * 9 + rows[r] : rows[r] * 9 + cols[c];
+      out[r * 9 + c] = relabel[seed[from] - '0'];
+    }
+  }
+}
+
+int gen_unique(int hints, bool symmetric, uint32_t *state, uint8_t out[81],
+               gen_stats_t *stats) {
+  double start = engine_seconds();
+  gen_solved(state, out);
+
+  // The cells to try, or in symmetric order the first of each pair (the
+  // centre, 40, is its own pair)
+  uint8_t order[81];
+  int n_order = symmetric ? 41 : 81;
+  for (int i = 0; i < n_order; i++) {
+    order[i] = i;
+  }
+  shuffle(state, order, n_order);
+
+  int left = 81;
+  long calls = 0;
+  uint64_t nodes = 0;
+  for (int i = 0; i < n_order && left > hints; i++) {
+    int cell = order[i], twin = 80 - cell;
+    bool pair = symmetric && twin != cell;
+    if (left - (pair ? 2 : 1) < hints) {
+      continue;
+    }
+    uint8_t value = out[cell], twin_value = out[twin];
+    out[cell] = 0;
+    if (pair) {
+      out[twin] = 0;
+    }
+    calls++;
+    if (engine_count(out, 2, &nodes) == 1) {
+      left -= pair ? 2 : 1;
+    } else {
+      out[cell] = value;
+      out[twin] = twin_value;
+    }
+  }
+
+  if (stats != NULL) {
+    stats->hints = left;
+    stats->solver_calls = calls;
+    stats->seconds = engine_seconds() - start;
+    stats->tries = 1;
+    stats->rating = -1;
+  }
+  return left;
+}
+
+int gen_graded(int hints, grade_band_t band, bool symmetric, uint32_t *state, uint8_t out[81],
+               gen_stats_t *stats) {
+  double start = engine_seconds();
+  gen_stats_t total = {};
+  grade_t g;
+  do {
+    gen_stats_t one;
+    gen_unique(hints, symmetric, state, out, &one);
+    grade_board(out, &g);
+    total.hints = one.hints;
+    total.solver_calls += one.solver_calls + 1;  // and the grader's
+    total.tries++;
+  } while (grade_band(&g) != band && total.tries < GEN_GRADE_TRIES);
+
+  total.seconds = engine_seconds() - start;
+  total.rating = g.rating;
+  if (stats != NULL) {
+    *stats = total;
+  }
+  return g.rating;
+}
@@ -0,0 +1,73 @@
+/*
+ * Puzzle generator: boards with exactly one solution.
+ *
+ * Solved boards are made without any search, from a few seed boards: the
+ * rows are shuffled within each band of three and the bands shuffled, the
+ * same for the columns and stacks, the digits relabelled and the board
+ * turned on its diagonal half the time.  None of these can break a row,
+ * column or box, and together they give each of a seed board's variants
+ * (about 1.2 trillion transforms) with equal chance, in well under a
+ * microsecond.
+ *
+ * A random solved board is emptied one cell at a time, in a random order.
+ * After each removal the solutions are counted up to 2 (engine_count(),
+ * which for the bitmask engine is counter.cpp); if there is more than one,
+ * the cell is put back and the next one tried.  This stops when the board
+ * is down to the hints asked for, or when every cell has been tried, in
+ * which case no hint can be taken away without losing uniqueness: the
+ * board is minimal.  Few boards have a minimal puzzle under 20 hints, so
+ * a low target usually ends at a minimal puzzle of 22-26 hints.
+ *
+ * In symmetric order the cells go in pairs, each with the cell opposite it
+ * through the centre, so the hints look the same turned half way round,
+ * as in printed puzzles; the board ends minimal as far as pairs go, a few
+ * hints above a random order's.
+ *
+ * For a difficulty band (see grader.h), boards are made and graded until
+ * one falls in it.  About half of all minimal boards need only singles, a
+ * sixth need locked candidates or subsets, and a third need fish or
+ * guessing, so a board in any band takes a few tries.
+ */
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <stdint.h>
+
+#include "grader.h"
+
+#define GEN_GRADE_TRIES 100  // boards made for a band before taking the last one
+
+typedef struct {
+  int hints;          // left in the board
+  long solver_calls;  // uniqueness checks made
+  double seconds;     // to make the board
+  int tries;          // boards made to get one in the band asked for
+  int rating;         // see grader.h; -1 if not graded
+} gen_stats_t;
+
+/* Random number from 0 to n - 1, from a xorshift32 state (not 0). */
+uint32_t gen_random_below(uint32_t *state, uint32_t n);
+
+/* Makes a random solved board into out, by transforming a seed board. */
+void gen_solved(uint32_t *state, uint8_t out[81]);
+
+/* Makes a board with exactly one solution and at least hints hints (0-81;
+ * 0 for a minimal board) into out, emptying cells in symmetric pairs if
+ * symmetric is true.  Fills in *stats if it is not NULL.
+ *
+ * Returns the number of hints left.
+ */
+int gen_unique(int hints, bool symmetric, uint32_t *state, uint8_t out[81],
+               gen_stats_t *stats);
+
+/* As gen_unique(), making boards until one is graded in band (or
+ * GEN_GRADE_TRIES have been made), with the work for all of them in
+ * *stats.
+ *
+ * Returns the board's rating.
+ */
+int gen_graded(int hints, grade_band_t band, bool symmetric, uint32_t *state, uint8_t out[81],
+               gen_stats_t *stats);
+
+#endif
@@ -0,0 +1,367 @@
+/*
+ * Difficulty grader: solves a board the way a person would.
+ */
+
+#include <string.h>
+
+#include "grader.h"
+#include "counter.h"
+#include "units.h"
+
+typedef struct {
+  uint8_t cells[81];   // 0 for an empty cell
+  uint16_t cand[81];   // candidates of the empty cells
+  int empty;
+} grade_board_t;
+
+static const char *const technique_names[GRADE_TECHNIQUES] = {
+  "hidden single", "naked single", "pointing", "claiming", "naked pair", "hidden pair",
+  "naked triple", "hidden triple", "x-wing", "swordfish", "guess"
+};
+
+static inline int box_of(int cell) {
+  return cell / 27 * 3 + cell % 9 / 3;
+}
+
+static void place(grade_board_t *b, int cell, uint8_t d) {
+  uint16_t bit = 1 << (d - 1);
+  b->cells[cell] = d;
+  b->cand[cell] = 0;
+  b->empty--;
+  for (int k = 0; k < 20; k++) {
+    b->cand[board_peers[cell][k]] &= ~bit;
+  }
+}
+
+/* Takes the digits in mask from an empty cell's candidates.
+ *
+ * Returns true if that took any away.
+ */
+static inline bool eliminate(grade_board_t *b, int cell, uint16_t mask) {
+  if (b->cand[cell] & mask) {
+    b->cand[cell] &= ~mask;
+    return true;
+  }
+  return false;
+}
+
+/* Each technique takes as many steps as it finds in one pass over the
+ * board and returns how many it took, 0 if it found none.
+ */
+
+static int hidden_singles(grade_board_t *b) {
+  int steps = 0;
+  for (int u = 0; u < 27; u++) {
+    const uint8_t *unit = board_units[u];
+    uint16_t once = 0, twice = 0;
+    for (int k = 0; k < 9; k++) {
+      twice |= once & b->cand[unit[k]];
+      once |= b->cand[unit[k]];
+    }
+    for (uint16_t hidden = once & ~twice; hidden != 0; hidden &= hidden - 1) {
+      uint16_t bit = hidden & -hidden;
+      for (int k = 0; k < 9; k++) {
+        if (b->cand[unit[k]] & bit) {  // not taken by a step before it
+          place(b, unit[k], __builtin_ctz(bit) + 1);
+          steps++;
+          break;
+        }
+      }
+    }
+  }
+  return steps;
+}
+
+static int naked_singles(grade_board_t *b) {
+  int steps = 0;
+  for (int c = 0; c < 81; c++) {
+    uint16_t m = b->cand[c];
+    if (m != 0 && (m & (m - 1)) == 0) {
+      place(b, c, __builtin_ctz(m) + 1);
+      steps++;
+    }
+  }
+  return steps;
+}
+
+/* A digit whose places in a box are all on one row or column can go
+ * nowhere else on that row or column.
+ */
+static int pointing(grade_board_t *b) {
+  int steps = 0;
+  for (int bx = 0; bx < 9; bx++) {
+    const uint8_t *box = board_units[18 + bx];
+    for (uint16_t bit = 1; bit < ALL_DIGITS; bit <<= 1) {
+      uint16_t rows = 0, cols = 0;
+      for (int k = 0; k < 9; k++) {
+        if (b->cand[box[k]] & bit) {
+          rows |= 1 << (box[k] / 9);
+          cols |= 1 << (box[k] % 9);
+        }
+      }
+      bool changed = false;
+      if (rows != 0 && (rows & (rows - 1)) == 0) {
+        const uint8_t *row = board_units[__builtin_ctz(rows)];
+        for (int k = 0; k < 9; k++) {
+          if (box_of(row[k]) != bx) {
+            changed |= eliminate(b, row[k], bit);
+          }
+        }
+      }
+      if (cols != 0 && (cols & (cols - 1)) == 0) {
+        const uint8_t *col = board_units[9 + __builtin_ctz(cols)];
+        for (int k = 0; k < 9; k++) {
+          if (box_of(col[k]) != bx) {
+            changed |= eliminate(b, col[k], bit);
+          }
+        }
+      }
+      steps += changed;
+    }
+  }
+  return steps;
+}
+
+/* A digit whose places in a row or column are all in one box can go
+ * nowhere else in that box.
+ */
+static int claiming(grade_board_t *b) {
+  int steps = 0;
+  for (int u = 0; u < 18; u++) {
+    const uint8_t *line = board_units[u];
+    for (uint16_t bit = 1; bit < ALL_DIGITS; bit <<= 1) {
+      uint16_t boxes = 0;
+      for (int k = 0; k < 9; k++) {
+        if (b->cand[line[k]] & bit) {
+          boxes |= 1 << box_of(line[k]);
+        }
+      }
+      if (boxes == 0 || (boxes & (boxes - 1)) != 0) {
+        continue;
+      }
+      const uint8_t *box = board_units[18 + __builtin_ctz(boxes)];
+      bool changed = false;
+      for (int k = 0; k < 9; k++) {
+        bool on_line = u < 9 ? box[k] / 9 == u : box[k] % 9 == u - 9;
+        if (!on_line) {
+          changed |= eliminate(b, box[k], bit);
+        }
+      }
+      steps += changed;
+    }
+  }
+  return steps;
+}
+
+/* Calls apply(union, chosen) for each set of size of the nine masks
+ * (size 2 or 3; masks of 0 are left out) whose union has size bits, with
+ * the chosen masks as bits of chosen, until apply returns true.
+ *
+ * Returns true if it did.
+ */
+template <typename F>
+static bool each_subset(const uint16_t masks[9], int size, F apply) {
+  for (int i = 0; i < 9; i++) {
+    if (masks[i] == 0) {
+      continue;
+    }
+    for (int j = i + 1; j < 9; j++) {
+      if (masks[j] == 0) {
+        continue;
+      }
+      uint16_t pair = masks[i] | masks[j];
+      if (size == 2) {
+        if (__builtin_popcount(pair) == 2 && apply(pair, (1 << i) | (1 << j))) {
+          return true;
+        }
+        continue;
+      }
+      for (int k = j + 1; k < 9; k++) {
+        uint16_t triple = pair | masks[k];
+        if (masks[k] != 0 && __builtin_popcount(triple) == 3 &&
+            apply(triple, (1 << i) | (1 << j) | (1 << k))) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+/* Keeps the masks with 2 to size bits, zeroing the rest. */
+static void keep_small(uint16_t masks[9], int size) {
+  for (int i = 0; i < 9; i++) {
+    int n = __builtin_popcount(masks[i]);
+    if (n < 2 || n > size) {
+      masks[i] = 0;
+    }
+  }
+}
+
+/* size cells in a unit with size candidates between them: those digits
+ * can go in no other cell of the unit.
+ */
+static int naked_subsets(grade_board_t *b, int size) {
+  int steps = 0;
+  for (int u = 0; u < 27; u++) {
+    const uint8_t *unit = board_units[u];
+    uint16_t masks[9];
+    for (int k = 0; k < 9; k++) {
+      masks[k] = b->cand[unit[k]];
+    }
+    keep_small(masks, size);
+    steps += each_subset(masks, size, [b, unit](uint16_t digits, uint16_t cells) {
+      bool changed = false;
+      for (int k = 0; k < 9; k++) {
+        if (!(cells & (1 << k))) {
+          changed |= eliminate(b, unit[k], digits);
+        }
+      }
+      return changed;
+    });
+  }
+  return steps;
+}
+
+/* size digits with size places between them in a unit: those cells can
+ * hold no other digit.
+ */
+static int hidden_subsets(grade_board_t *b, int size) {
+  int steps = 0;
+  for (int u = 0; u < 27; u++) {
+    const uint8_t *unit = board_units[u];
+    uint16_t masks[9] = { 0 };  // the places of each digit
+    for (int k = 0; k < 9; k++) {
+      for (uint16_t m = b->cand[unit[k]]; m != 0; m &= m - 1) {
+        masks[__builtin_ctz(m)] |= 1 << k;
+      }
+    }
+    keep_small(masks, size);
+    steps += each_subset(masks, size, [b, unit](uint16_t places, uint16_t digits) {
+      bool changed = false;
+      for (int k = 0; k < 9; k++) {
+        if (places & (1 << k)) {
+          changed |= eliminate(b, unit[k], ALL_DIGITS & ~digits);
+        }
+      }
+      return changed;
+    });
+  }
+  return steps;
+}
+
+/* A digit whose places in size rows are all in the same size columns can
+ * go nowhere else in those columns; the same with rows and columns
+ * swapped.
+ */
+static int fish(grade_board_t *b, int size) {
+  int steps = 0;
+  for (uint16_t bit = 1; bit < ALL_DIGITS; bit <<= 1) {
+    for (int by_rows = 0; by_rows < 2; by_rows++) {
+      // Cell i of line j is lines[j][i]: rows then columns, or the reverse
+      const uint8_t (*lines)[9] = by_rows ? board_units : board_units + 9;
+      const uint8_t (*across)[9] = by_rows ? board_units + 9 : board_units;
+      uint16_t masks[9];
+      for (int j = 0; j < 9; j++) {
+        masks[j] = 0;
+        for (int i = 0; i < 9; i++) {
+          if (b->cand[lines[j][i]] & bit) {
+            masks[j] |= 1 << i;
+          }
+        }
+      }
+      keep_small(masks, size);
+      steps += each_subset(masks, size, [b, bit, across](uint16_t places, uint16_t chosen) {
+        bool changed = false;
+        for (int i = 0; i < 9; i++) {
+          if (places & (1 << i)) {
+            for (int j = 0; j < 9; j++) {
+              if (!(chosen & (1 << j))) {
+                changed |= eliminate(b, across[i][j], bit);
+              }
+            }
+          }
+        }
+        return changed;
+      });
+    }
+  }
+  return steps;
+}
+
+static int naked_pairs(grade_board_t *b) { return naked_subsets(b, 2); }
+static int hidden_pairs(grade_board_t *b) { return hidden_subsets(b, 2); }
+static int naked_triples(grade_board_t *b) { return naked_subsets(b, 3); }
+static int hidden_triples(grade_board_t *b) { return hidden_subsets(b, 3); }
+static int x_wing(grade_board_t *b) { return fish(b, 2); }
+static int swordfish(grade_board_t *b) { return fish(b, 3); }
+
+// In grade_technique_t order, easiest first
+static int (*const techniques[GRADE_GUESS])(grade_board_t *) = {
+  hidden_singles, naked_singles, pointing, claiming, naked_pairs, hidden_pairs,
+  naked_triples, hidden_triples, x_wing, swordfish
+};
+
+bool grade_board(const uint8_t cells[81], grade_t *g) {
+  uint8_t solution[81];
+  uint64_t nodes = 0;
+  if (counter_count(cells, 2, solution, &nodes) != 1) {
+    return false;
+  }
+
+  grade_board_t b;
+  memset(b.cells, 0, sizeof(b.cells));
+  for (int c = 0; c < 81; c++) {
+    b.cand[c] = ALL_DIGITS;
+  }
+  b.empty = 81;
+  for (int c = 0; c < 81; c++) {
+    if (cells[c] != 0) {
+      place(&b, c, cells[c]);
+    }
+  }
+
+  memset(g, 0, sizeof(*g));
+  g->hardest = GRADE_HIDDEN_SINGLE;
+  while (b.empty > 0) {
+    int t = 0;
+    int steps = 0;
+    while (t < GRADE_GUESS && (steps = techniques[t](&b)) == 0) {
+      t++;
+    }
+    if (t == GRADE_GUESS) {
+      int best = -1, best_count = 10;
+      for (int c = 0; c < 81; c++) {
+        int count = __builtin_popcount(b.cand[c]);
+        if (b.cells[c] == 0 && count < best_count) {
+          best = c;
+          best_count = count;
+        }
+      }
+      place(&b, best, solution[best]);
+      steps = 1;
+    }
+    g->uses[t] += steps;
+    if (t > g->hardest) {
+      g->hardest = (grade_technique_t) t;
+    }
+  }
+
+  int extra = 0;
+  for (int t = GRADE_POINTING; t < GRADE_TECHNIQUES; t++) {
+    extra += (t + 1) * g->uses[t];
+  }
+  g->rating = 100 * (g->hardest + 1) + (extra < 99 ? extra : 99);
+  return true;
+}
+
+grade_band_t grade_band(const grade_t *g) {
+  if (g->hardest <= GRADE_NAKED_SINGLE) {
+    return GRADE_EASY;
+  }
+  return g->hardest <= GRADE_HIDDEN_TRIPLE ? GRADE_MEDIUM : GRADE_HARD;
+}
+
+const char *grade_technique_name(grade_technique_t t) {
+  return technique_names[t];
+}
@@ -0,0 +1,146 @@
+/*
+ * libsudoku: the board solver as a shared library for the server.
+ */
+
+#include <string.h>
+
+#include "libsudoku.h"
+#include "engine.h"
+#include "generator.h"
+#include "grader.h"
+#include "pool.h"
+#include "split.h"
+
+static_assert(SUDOKU_TECHNIQUES == GRADE_TECHNIQUES, "libsudoku.h lists the techniques too");
+
+static bool split_search;  // solve on the pool, see sudoku_set_threads()
+
+static bool valid_cells(const uint8_t cells[81]) {
+  for (int i = 0; i < 81; i++) {
+    if (cells[i] > 9) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int sudoku_abi_version(void) {
+  return SUDOKU_ABI_VERSION;
+}
+
+int sudoku_set_engine(const char *name) {
+  return engine_select_name(name) ? 0 : -1;
+}
+
+int sudoku_set_threads(int threads) {
+  if (split_search) {
+    pool_stop();
+    split_search = false;
+  }
+  if (threads == 1) {
+    return 1;
+  }
+  split_search = true;
+  return pool_start(threads);
+}
+
+int sudoku_solve(const uint8_t cells[81], uint8_t out[81]) {
+  if (!valid_cells(cells)) {
+    return -1;
+  }
+  uint64_t nodes = 0;
+  if (split_search) {
+    return split_solve(cells, out, &nodes) == SOLVER_SOLVED;
+  }
+  return engine_solve(cells, out, &nodes) == SOLVER_SOLVED;
+}
+
+int sudoku_check(const uint8_t cells[81]) {
+  for (int i = 0; i < 81; i++) {
+    if (cells[i] < 1 || cells[i] > 9) {
+      return 0;
+    }
+  }
+  uint16_t rows[9], cols[9], boxes[9];
+  return engine_givens(cells, rows, cols, boxes);
+}
+
+long sudoku_count_solutions(const uint8_t cells[81], long limit) {
+  if (!valid_cells(cells)) {
+    return -1;
+  }
+  uint64_t nodes = 0;
+  if (split_search) {
+    return split_count(cells, limit, &nodes);
+  }
+  return engine_count(cells, limit, &nodes);
+}
+
+int sudoku_generate(int hints, uint32_t seed, uint8_t out[81]) {
+  if (hints < 0 || hints > 81) {
+    return -1;
+  }
+  uint32_t state = seed != 0 ? seed : 0x9E3779B9;
+  gen_solved(&state, out);
+
+  // Empty 81 - hints cells, picked by a partial shuffle of the positions
+  uint8_t order[81];
+  for (int i = 0; i < 81; i++) {
+    order[i] = i;
+  }
+  for (int i = 0; i < 81 - hints; i++) {
+    int j = i + gen_random_below(&state, 81 - i);
+    uint8_t t = order[i];
+    order[i] = order[j];
+    order[j] = t;
+    out[order[i]] = 0;
+  }
+  return 0;
+}
+
+int sudoku_generate_unique(int hints, int symmetric, uint32_t seed, uint8_t out[81],
+                           long *solver_calls, double *seconds) {
+  if (hints < 0 || hints > 81) {
+    return -1;
+  }
+  uint32_t state = seed != 0 ? seed : 0x9E3779B9;
+  gen_stats_t stats;
+  gen_unique(hints, symmetric != 0, &state, out, &stats);
+  if (solver_calls != NULL) {
+    *solver_calls = stats.solver_calls;
+  }
+  if (seconds != NULL) {
+    *seconds = stats.seconds;
+  }
+  return stats.hints;
+}
+
+int sudoku_grade(const uint8_t cells[81], int uses[SUDOKU_TECHNIQUES]) {
+  grade_t g;
+  if (!valid_cells(cells) || !grade_board(cells, &g)) {
+    return -1;
+  }
+  if (uses != NULL) {
+    for (int t = 0; t < SUDOKU_TECHNIQUES; t++) {
+      uses[t] = g.uses[t];
+    }
+  }
+  return g.rating;
+}
+
+int sudoku_generate_graded(int hints, int band, int symmetric, uint32_t seed, uint8_t out[81],
+                           long *solver_calls, double *seconds) {
+  if (hints < 0 || hints > 81 || band < GRADE_EASY || band > GRADE_HARD) {
+    return -1;
+  }
+  uint32_t state = seed != 0 ? seed : 0x9E3779B9;
+  gen_stats_t stats;
+  gen_graded(hints, (grade_band_t) band, symmetric != 0, &state, out, &stats);
+  if (solver_calls != NULL) {
+    *solver_calls = stats.solver_calls;
+  }
+  if (seconds != NULL) {
+    *seconds = stats.seconds;
+  }
+  return stats.rating;
+}
@@ -0,0 +1,110 @@
+/*
+ * libsudoku: the board solver as a shared library for the server.
+ *
+ * A flat C interface, so sudokuServer.py can load it with ctypes.  Boards
+ * are 81 bytes, row by row, 0 for an empty cell and 1-9 otherwise, the
+ * same as the colour lists the server keeps.  The solver is the one the
+ * Arduino runs (board_solver.cpp): a depth first search branching on the
+ * cell with the fewest candidates, with candidates kept as bitmasks.  A
+ * dancing links solver can be chosen instead with sudoku_set_engine().
+ */
+
+#ifndef LIBSUDOKU_H
+#define LIBSUDOKU_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever a function changes, so callers can check they match. */
+#define SUDOKU_ABI_VERSION 5
+
+int sudoku_abi_version(void);
+
+/* Chooses the solver for every call after it: "bitmask" (the default) or
+ * "dlx".
+ *
+ * Returns 0, or -1 if there is no solver by that name.
+ */
+int sudoku_set_engine(const char *name);
+
+/* Solves and counts each board on this many threads from then on (0 for
+ * one per CPU), by splitting its search between them; 1, the default,
+ * searches on the calling thread.  Splitting always uses the bitmask
+ * solver.
+ *
+ * Returns the number of threads.
+ */
+int sudoku_set_threads(int threads);
+
+/* Solves cells into out (which may be cells).
+ *
+ * Returns 1 if solved, 0 if the board has no solution, -1 if it holds a
+ * value other than 0-9.
+ */
+int sudoku_solve(const uint8_t cells[81], uint8_t out[81]);
+
+/* Returns 1 if cells is completely filled in with no digit repeated in a
+ * row, column or box, 0 otherwise.
+ */
+int sudoku_check(const uint8_t cells[81]);
+
+/* Counts the solutions of cells, stopping once limit are found (limit 0
+ * counts them all).
+ *
+ * Returns the count, or -1 if cells holds a value other than 0-9.
+ */
+long sudoku_count_solutions(const uint8_t cells[81], long limit);
+
+/* Makes a random board with the given number of hints (0-81) into out:
+ * a random solved board with 81 - hints cells emptied at random.  The
+ * same seed gives the same board.
+ *
+ * Returns 0, or -1 if hints is out of range.
+ */
+int sudoku_generate(int hints, uint32_t seed, uint8_t out[81]);
+
+/* Makes a random board with exactly one solution into out, emptying the
+ * cells of a random solved board one at a time (in pairs opposite each
+ * other if symmetric is not 0) for as long as the board stays unique, down
+ * to the given number of hints (0-81; 0 for a minimal board).  The same
+ * seed gives the same board.  The uniqueness checks made and the time
+ * taken go in *solver_calls and *seconds, either of which may be NULL.
+ *
+ * Returns the number of hints left, more than asked for if the board
+ * became minimal first, or -1 if hints is out of range.
+ */
+int sudoku_generate_unique(int hints, int symmetric, uint32_t seed, uint8_t out[81],
+                           long *solver_calls, double *seconds);
+
+/* The human techniques the grader knows, easiest first: hidden single,
+ * naked single, pointing, claiming, naked pair, hidden pair, naked triple,
+ * hidden triple, x-wing, swordfish, and guess when none of them helps.
+ */
+#define SUDOKU_TECHNIQUES 11
+
+/* Grades cells by the techniques a person would need to solve it, writing
+ * the steps taken with each into uses if it is not NULL.
+ *
+ * Returns the rating: 100 times the level of the hardest technique (1 for
+ * hidden single to 11 for guess) plus up to 99 for the harder steps, or -1
+ * if cells does not have exactly one solution.
+ */
+int sudoku_grade(const uint8_t cells[81], int uses[SUDOKU_TECHNIQUES]);
+
+/* As sudoku_generate_unique(), making boards until one is graded in band:
+ * 0 for easy (singles only), 1 for medium (locked candidates and subsets),
+ * 2 for hard (fish or guessing), giving up on the band after 100 boards.
+ *
+ * Returns the board's rating, or -1 if hints or band is out of range.
+ */
+int sudoku_generate_graded(int hints, int band, int symmetric, uint32_t seed, uint8_t out[81],
+                           long *solver_calls, double *seconds);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,219 @@
+/*
+ * Thread pool with work stealing.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <time.h>
+
+#include "pool.h"
+
+#define POOL_MAX_WORKERS 64
+#define POOL_DEQUE_SIZE 1024  // a power of two
+
+typedef struct {
+  pool_fn_t fn;
+  void *arg;
+} pool_task_t;
+
+/* The owner pushes and pops at the bottom, thieves take from the top.
+ * Tasks are coarse (a block of puzzles, a branch of a search), so a lock
+ * per deque costs nothing worth measuring.
+ */
+typedef struct {
+  std::mutex lock;
+  pool_task_t tasks[POOL_DEQUE_SIZE];
+  uint32_t top;
+  uint32_t bottom;
+} pool_deque_t;
+
+typedef struct {
+  pool_deque_t deque;
+  std::thread thread;
+  uint64_t tasks_run;
+  uint64_t tasks_stolen;
+  uint64_t busy_ns;  // CPU time running tasks
+} pool_worker_t;
+
+static pool_worker_t *workers;
+static int n_workers;
+static std::atomic<uint32_t> next_deque;
+
+// Sleeping: queued counts the tasks in all deques, raised under sleep_lock.
+// Never freed, so workers of a pool still running when the process exits
+// (one started by libsudoku, say) are not left on a destroyed variable.
+static std::mutex &sleep_lock = *new std::mutex;
+static std::condition_variable &wake = *new std::condition_variable;
+static std::atomic<int> queued;
+static bool stopping;
+
+static uint64_t start_ns, stop_ns;
+
+static thread_local int this_worker = -1;
+static thread_local int nesting;  // tasks run by pool_help() inside a task
+
+static uint64_t clock_ns(clockid_t clock) {
+  struct timespec t;
+  clock_gettime(clock, &t);
+  return (uint64_t) t.tv_sec * 1000000000u + t.tv_nsec;
+}
+
+static uint64_t now_ns(void) {
+  return clock_ns(CLOCK_MONOTONIC);
+}
+
+/* CPU time of the calling thread, so time spent waiting for a CPU does not
+ * count as busy.
+ */
+static uint64_t cpu_ns(void) {
+  return clock_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+static bool push(pool_deque_t *d, pool_fn_t fn, void *arg) {
+  std::lock_guard<std::mutex> hold(d->lock);
+  if (d->bottom - d->top == POOL_DEQUE_SIZE) {
+    return false;
+  }
+  d->tasks[d->bottom++ % POOL_DEQUE_SIZE] = { fn, arg };
+  return true;
+}
+
+static bool pop_bottom(pool_deque_t *d, pool_task_t *task) {
+  std::lock_guard<std::mutex> hold(d->lock);
+  if (d->bottom == d->top) {
+    return false;
+  }
+  *task = d->tasks[--d->bottom % POOL_DEQUE_SIZE];
+  return true;
+}
+
+static bool pop_top(pool_deque_t *d, pool_task_t *task) {
+  std::lock_guard<std::mutex> hold(d->lock);
+  if (d->bottom == d->top) {
+    return false;
+  }
+  *task = d->tasks[d->top++ % POOL_DEQUE_SIZE];
+  return true;
+}
+
+/* Finds a task for worker w: its own newest, or another's oldest. */
+static bool take(int w, pool_task_t *task) {
+  if (pop_bottom(&workers[w].deque, task)) {
+    queued--;
+    return true;
+  }
+  for (int k = 1; k < n_workers; k++) {
+    int victim = (w + k) % n_workers;
+    if (pop_top(&workers[victim].deque, task)) {
+      queued--;
+      workers[w].tasks_stolen++;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void run(int w, const pool_task_t *task) {
+  uint64_t t = nesting == 0 ? cpu_ns() : 0;
+  nesting++;
+  task->fn(task->arg);
+  nesting--;
+  if (nesting == 0) {
+    workers[w].busy_ns += cpu_ns() - t;
+  }
+  workers[w].tasks_run++;
+}
+
+static void worker_main(int w) {
+  this_worker = w;
+  pool_task_t task;
+  for (;;) {
+    if (take(w, &task)) {
+      run(w, &task);
+      continue;
+    }
+    std::unique_lock<std::mutex> hold(sleep_lock);
+    if (queued == 0 && stopping) {
+      return;
+    }
+    wake.wait(hold, [] { return queued > 0 || stopping; });
+  }
+}
+
+int pool_start(int n) {
+  if (n <= 0) {
+    n = std::thread::hardware_concurrency();
+  }
+  if (n < 1) {
+    n = 1;
+  }
+  if (n > POOL_MAX_WORKERS) {
+    n = POOL_MAX_WORKERS;
+  }
+  delete[] workers;  // from a pool started and stopped before
+  n_workers = n;
+  workers = new pool_worker_t[n]();
+  stopping = false;
+  start_ns = now_ns();
+  for (int w = 0; w < n; w++) {
+    workers[w].thread = std::thread(worker_main, w);
+  }
+  return n;
+}
+
+void pool_stop(void) {
+  {
+    std::lock_guard<std::mutex> hold(sleep_lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (int w = 0; w < n_workers; w++) {
+    workers[w].thread.join();
+  }
+  stop_ns = now_ns();
+}
+
+void pool_submit(pool_fn_t fn, void *arg) {
+  // Counted before it is pushed, so queued is never below the number of
+  // tasks in the deques and no worker sleeps while one is waiting
+  {
+    std::lock_guard<std::mutex> hold(sleep_lock);
+    queued++;
+  }
+  int w = this_worker >= 0 ? this_worker : next_deque++ % n_workers;
+  if (!push(&workers[w].deque, fn, arg)) {
+    queued--;
+    fn(arg);
+    return;
+  }
+  wake.notify_one();
+}
+
+bool pool_help(void) {
+  pool_task_t task;
+  if (this_worker < 0 || !take(this_worker, &task)) {
+    return false;
+  }
+  run(this_worker, &task);
+  return true;
+}
+
+int pool_size(void) {
+  return n_workers;
+}
+
+int pool_worker(void) {
+  return this_worker;
+}
+
+void pool_report(FILE *f) {
+  uint64_t wall = (stop_ns > start_ns ? stop_ns : now_ns()) - start_ns;
+  for (int w = 0; w < n_workers; w++) {
+    const pool_worker_t *p = &workers[w];
+    fprintf(f, "thread %d: %llu tasks, %llu stolen, %.0f%% busy\n", w,
+            (unsigned long long) p->tasks_run, (unsigned long long) p->tasks_stolen,
+            wall > 0 ? 100.0 * p->busy_ns / wall : 0.0);
+  }
+}
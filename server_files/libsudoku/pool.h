@@ -0,0 +1,52 @@
+/*
+ * Thread pool with work stealing.
+ *
+ * Each worker has a deque of tasks of its own.  It takes the newest task
+ * off its own deque, and when that is empty steals the oldest task off
+ * another worker's, so a worker stuck on a long task does not hold up the
+ * ones queued behind it.  Workers with nothing to do sleep until a task
+ * is submitted.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef void (*pool_fn_t)(void *arg);
+
+/* Starts the pool with the given number of workers (0 for one per CPU).
+ *
+ * Returns the number of workers started.
+ */
+int pool_start(int workers);
+
+/* Stops the workers once every task submitted has run. */
+void pool_stop(void);
+
+/* Queues fn(arg) to run on a worker.  From a worker, the task goes on its
+ * own deque; from any other thread, on each worker's in turn.  If the
+ * deque is full the task runs straight away instead.
+ */
+void pool_submit(pool_fn_t fn, void *arg);
+
+/* Runs a queued task, if there is one, on the calling worker; for waiting
+ * on other tasks without leaving the worker idle.
+ *
+ * Returns false if there was nothing to run.
+ */
+bool pool_help(void);
+
+/* The number of workers. */
+int pool_size(void);
+
+/* The number of the worker calling, or -1 if it is not a worker. */
+int pool_worker(void);
+
+/* Prints a line for each worker: tasks run, tasks stolen and the CPU time
+ * spent running tasks, as a share of the time since pool_start().
+ */
+void pool_report(FILE *f);
+
+#endif
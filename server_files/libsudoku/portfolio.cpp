@@ -0,0 +1,178 @@
+/*
+ * Solver portfolio: races several solvers on the same board.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string.h>
+
+#include "portfolio.h"
+#include "dlx.h"
+#include "pool.h"
+#include "simd.h"
+
+#define PORTFOLIO_SLICE 2048  // bitmask nodes between looks at the stop flag
+
+static const char *const solver_names[PORTFOLIO_SOLVERS] = { "bitmask", "dlx", "simd" };
+
+/* Ranges of givens the wins are counted by: the first given number in
+ * each, and a name for it.
+ */
+#define PORTFOLIO_RANGES 4
+static const int range_start[PORTFOLIO_RANGES] = { 0, 25, 35, 50 };
+static const char *const range_names[PORTFOLIO_RANGES] = { "0-24", "25-34", "35-49", "50-81" };
+
+static std::atomic<uint64_t> wins[PORTFOLIO_RANGES][PORTFOLIO_SOLVERS];
+
+typedef struct {
+  const uint8_t *cells;
+  std::atomic<bool> stop;
+  std::atomic<uint64_t> nodes;
+
+  std::mutex lock;  // guards the rest
+  std::condition_variable finished;
+  int pending;      // solvers not finished yet
+  int winner;       // -1 until one finishes
+  solver_status_t status;
+  uint8_t solution[81];
+} portfolio_race_t;
+
+typedef struct {
+  portfolio_race_t *race;
+  portfolio_solver_t solver;
+} portfolio_entry_t;
+
+/* Runs the bitmask solver in slices until it finishes or is stopped.
+ *
+ * Returns SOLVER_RUNNING if it was stopped.
+ */
+static solver_status_t run_bitmask(portfolio_race_t *race, const uint8_t cells[81],
+                                   uint8_t out[81]) {
+  board_solver_t s;
+  board_solver_begin(&s, cells);
+  solver_status_t status = SOLVER_RUNNING;
+  while (!race->stop) {
+    status = board_solver_run(&s, PORTFOLIO_SLICE);
+    if (status != SOLVER_RUNNING) {
+      break;
+    }
+  }
+  race->nodes += s.nodes;
+  if (status == SOLVER_SOLVED) {
+    memcpy(out, s.cells, 81);
+  }
+  return status;
+}
+
+static solver_status_t run_dlx(portfolio_race_t *race, uint8_t out[81]) {
+  uint64_t nodes = 0;
+  long n = dlx_solve(race->cells, out, 1, &nodes, &race->stop);
+  race->nodes += nodes;
+  if (n < 0) {
+    return SOLVER_RUNNING;
+  }
+  return n == 1 ? SOLVER_SOLVED : SOLVER_UNSOLVABLE;
+}
+
+static solver_status_t run_simd(portfolio_race_t *race, uint8_t out[81]) {
+  uint8_t found[1][81];
+  solver_status_t status;
+  simd_singles((const uint8_t (*)[81]) race->cells, found, &status, 1);
+  if (status != SOLVER_RUNNING) {
+    memcpy(out, found[0], 81);
+    return status;
+  }
+  return run_bitmask(race, found[0], out);
+}
+
+/* A pool task: one solver's run in the race. */
+static void race_task(void *arg) {
+  portfolio_entry_t *entry = (portfolio_entry_t *) arg;
+  portfolio_race_t *race = entry->race;
+
+  uint8_t out[81];
+  solver_status_t status = SOLVER_RUNNING;
+  if (!race->stop) {
+    switch (entry->solver) {
+      case PORTFOLIO_BITMASK:
+        status = run_bitmask(race, race->cells, out);
+        break;
+      case PORTFOLIO_DLX:
+        status = run_dlx(race, out);
+        break;
+      default:
+        status = run_simd(race, out);
+        break;
+    }
+  }
+
+  std::lock_guard<std::mutex> hold(race->lock);
+  if (status != SOLVER_RUNNING && race->winner < 0) {
+    race->winner = entry->solver;
+    race->status = status;
+    memcpy(race->solution, out, 81);
+    race->stop = true;
+  }
+  if (--race->pending == 0) {
+    race->finished.notify_all();
+  }
+}
+
+static int givens_range(const uint8_t cells[81]) {
+  int givens = 0;
+  for (int i = 0; i < 81; i++) {
+    givens += cells[i] != 0;
+  }
+  int r = PORTFOLIO_RANGES - 1;
+  while (givens < range_start[r]) {
+    r--;
+  }
+  return r;
+}
+
+solver_status_t portfolio_solve(const uint8_t cells[81], uint8_t out[81], uint64_t *nodes,
+                                portfolio_solver_t *winner) {
+  portfolio_race_t race;
+  race.cells = cells;
+  race.stop = false;
+  race.nodes = 0;
+  race.pending = PORTFOLIO_SOLVERS;
+  race.winner = -1;
+
+  portfolio_entry_t entries[PORTFOLIO_SOLVERS];
+  for (int k = 0; k < PORTFOLIO_SOLVERS; k++) {
+    entries[k].race = &race;
+    entries[k].solver = (portfolio_solver_t) k;
+    pool_submit(race_task, &entries[k]);
+  }
+  {
+    std::unique_lock<std::mutex> hold(race.lock);
+    race.finished.wait(hold, [&race] { return race.pending == 0; });
+  }
+
+  wins[givens_range(cells)][race.winner]++;
+  *nodes += race.nodes;
+  if (winner != NULL) {
+    *winner = (portfolio_solver_t) race.winner;
+  }
+  if (race.status == SOLVER_SOLVED) {
+    memcpy(out, race.solution, 81);
+  }
+  return race.status;
+}
+
+void portfolio_report(FILE *f) {
+  fprintf(f, "givens");
+  for (int k = 0; k < PORTFOLIO_SOLVERS; k++) {
+    fprintf(f, ",%s", solver_names[k]);
+  }
+  fprintf(f, "\n");
+  for (int r = 0; r < PORTFOLIO_RANGES; r++) {
+    fprintf(f, "%s", range_names[r]);
+    for (int k = 0; k < PORTFOLIO_SOLVERS; k++) {
+      fprintf(f, ",%llu", (unsigned long long) wins[r][k]);
+    }
+    fprintf(f, "\n");
+  }
+}
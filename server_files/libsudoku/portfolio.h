@@ -0,0 +1,44 @@
+/*
+ * Solver portfolio: races several solvers on the same board.
+ *
+ * The bitmask solver, the dancing links solver and the SIMD singles
+ * kernel (finishing with the bitmask solver) each run as a pool task on
+ * the board (pool.h).  The first to finish gives the answer and sets a
+ * shared flag, and the others give up when they next look at it.  Which
+ * solver won is counted by the number of givens, so the counts show
+ * which one to use by default for boards like the game's easy (60 hints),
+ * medium (40) and hard (20) ones.
+ *
+ * The pool must have been started, and races are run from outside it; with
+ * fewer workers than solvers, the ones that start late only race what is
+ * left.
+ */
+
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "board_solver.h"
+
+typedef enum {
+  PORTFOLIO_BITMASK,
+  PORTFOLIO_DLX,
+  PORTFOLIO_SIMD,
+  PORTFOLIO_SOLVERS
+} portfolio_solver_t;
+
+/* As engine_solve(), racing the solvers.  The search nodes of every
+ * solver taking part are added to *nodes.
+ *
+ * Returns SOLVER_SOLVED or SOLVER_UNSOLVABLE, and the solver that won in
+ * *winner if it is not NULL.
+ */
+solver_status_t portfolio_solve(const uint8_t cells[81], uint8_t out[81], uint64_t *nodes,
+                                portfolio_solver_t *winner);
+
+/* Prints how many races each solver has won, for each range of givens. */
+void portfolio_report(FILE *f);
+
+#endif
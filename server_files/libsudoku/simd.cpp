@@ -0,0 +1,123 @@
+/*
+ * Batch solving, several boards at a time.
+ */
+
+#include <atomic>
+#include <string.h>
+
+#include "simd_kernel.h"
+#include "engine.h"
+
+/* 8 boards in 16 bytes: SSE2 on x86-64, NEON on ARM, and ordinary
+ * integer code where there is no vector unit.
+ */
+typedef uint16_t simd_generic_vec __attribute__((vector_size(16)));
+
+static void propagate_generic(const uint8_t (*cells)[81], uint8_t (*out)[81],
+                              solver_status_t *status, int n) {
+  simd_propagate<simd_generic_vec>(cells, out, status, n);
+}
+
+const simd_kernel_t simd_generic = { "generic", 8, propagate_generic };
+
+static const simd_kernel_t simd_scalar = { "scalar", 1, NULL };
+
+static bool cpu_runs(const simd_kernel_t *k) {
+  if (k->lanes == 0) {
+    return false;
+  }
+#if defined(__x86_64__) || defined(__i386__)
+  if (k == &simd_avx2) {
+    return __builtin_cpu_supports("avx2");
+  }
+#endif
+  return true;
+}
+
+static const simd_kernel_t *best_kernel(void) {
+  return cpu_runs(&simd_avx2) ? &simd_avx2 : &simd_generic;
+}
+
+// Chosen on first use; atomic, as the first use may be on several threads
+static std::atomic<const simd_kernel_t *> simd_kernel(NULL);
+
+static const simd_kernel_t *kernel(void) {
+  const simd_kernel_t *k = simd_kernel;
+  if (k == NULL) {
+    k = best_kernel();
+    simd_kernel = k;
+  }
+  return k;
+}
+
+bool simd_select_name(const char *name) {
+  if (strcmp(name, "auto") == 0) {
+    simd_kernel = best_kernel();
+    return true;
+  }
+  const simd_kernel_t *kernels[] = { &simd_avx2, &simd_generic, &simd_scalar };
+  for (const simd_kernel_t *k : kernels) {
+    if (strcmp(name, k->name) == 0 && cpu_runs(k)) {
+      simd_kernel = k;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *simd_name(void) {
+  return kernel()->name;
+}
+
+int simd_lanes(void) {
+  return kernel()->lanes;
+}
+
+void simd_singles(const uint8_t (*cells)[81], uint8_t (*out)[81],
+                  solver_status_t *status, int n) {
+  const simd_kernel_t *k = kernel();
+  if (k->propagate != NULL) {
+    k->propagate(cells, out, status, n);
+    return;
+  }
+  for (int i = 0; i < n; i++) {
+    memmove(out[i], cells[i], 81);
+    status[i] = SOLVER_RUNNING;
+  }
+}
+
+void simd_solve(const uint8_t (*cells)[81], uint8_t (*out)[81],
+                solver_status_t *status, int n, uint64_t *nodes) {
+  const simd_kernel_t *k = kernel();
+  if (k->propagate == NULL) {
+    for (int i = 0; i < n; i++) {
+      status[i] = engine_solve(cells[i], out[i], nodes);
+    }
+    return;
+  }
+
+  // Count the cells the singles filled in as search nodes, so the totals
+  // can be set beside the scalar engine's
+  uint8_t givens[SIMD_MAX_LANES];
+  for (int i = 0; i < n; i++) {
+    givens[i] = 0;
+    for (int c = 0; c < 81; c++) {
+      givens[i] += cells[i][c] != 0;
+    }
+  }
+
+  k->propagate(cells, out, status, n);
+  for (int i = 0; i < n; i++) {
+    if (status[i] == SOLVER_UNSOLVABLE) {
+      continue;
+    }
+    uint8_t found = 0;
+    for (int c = 0; c < 81; c++) {
+      found += out[i][c] != 0;
+    }
+    *nodes += found - givens[i];
+    if (status[i] == SOLVER_RUNNING) {
+      status[i] = engine_solve(out[i], out[i], nodes);
+    }
+  }
+}
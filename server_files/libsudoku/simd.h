@@ -0,0 +1,68 @@
+/*
+ * Batch solving, several boards at a time.
+ *
+ * The candidates of each cell are kept for a batch of boards side by side,
+ * one 16 bit lane per board, in vector registers: 8 boards to an SSE2
+ * register, 16 to an AVX2 one.  Naked singles (a cell with one candidate
+ * left) and hidden singles (a digit with one place left in a row, column
+ * or box) are then found on all of them at once, with the same
+ * instructions.  Most boards are solved by that alone; the ones that
+ * need guessing finish on the scalar engine (engine.h), starting from what
+ * was found.
+ *
+ * The widest kernel the CPU can run is picked at run time.
+ */
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+
+#include "board_solver.h"
+
+#define SIMD_MAX_LANES 16
+
+typedef struct {
+  const char *name;
+  int lanes;  // boards per batch; 0 if the kernel was not built
+  /* Fills in the singles of n <= lanes boards.  out[i] gets board i with
+   * every cell found filled in, and status[i] is SOLVER_SOLVED if that
+   * completes it, SOLVER_UNSOLVABLE if the board clashes, or
+   * SOLVER_RUNNING if it needs a search.
+   */
+  void (*propagate)(const uint8_t (*cells)[81], uint8_t (*out)[81],
+                    solver_status_t *status, int n);
+} simd_kernel_t;
+
+extern const simd_kernel_t simd_avx2;     // simd_avx2.cpp, built with -mavx2
+extern const simd_kernel_t simd_generic;  // SSE2 on x86, whatever the CPU has otherwise
+
+/* Chooses the kernel: "auto" for the widest one the CPU runs, "avx2",
+ * "generic", or "scalar" for none (each board on the scalar engine).
+ *
+ * Returns false, choosing nothing, if there is no such kernel or the CPU
+ * cannot run it.
+ */
+bool simd_select_name(const char *name);
+
+/* The name of the kernel in use. */
+const char *simd_name(void);
+
+/* Boards the kernel in use takes at once, 1 for scalar. */
+int simd_lanes(void);
+
+/* Fills in the singles of n <= simd_lanes() boards with the kernel in
+ * use, as simd_kernel_t.propagate.  The scalar kernel finds nothing, and
+ * leaves every board SOLVER_RUNNING.
+ */
+void simd_singles(const uint8_t (*cells)[81], uint8_t (*out)[81],
+                  solver_status_t *status, int n);
+
+/* Solves n <= simd_lanes() boards into out (which may be cells), adding
+ * the cells filled in to *nodes.  status[i] is SOLVER_SOLVED or
+ * SOLVER_UNSOLVABLE.
+ */
+void simd_solve(const uint8_t (*cells)[81], uint8_t (*out)[81],
+                solver_status_t *status, int n, uint64_t *nodes);
+
+#endif
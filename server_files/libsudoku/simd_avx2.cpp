@@ -0,0 +1,25 @@
+/*
+ * The singles kernel on AVX2: 16 boards at once.
+ *
+ * Only this file is built with -mavx2; simd.cpp checks that the CPU has
+ * AVX2 before using it.
+ */
+
+#include "simd_kernel.h"
+
+#ifdef __AVX2__
+
+typedef uint16_t simd_avx2_vec __attribute__((vector_size(32)));
+
+static void propagate_avx2(const uint8_t (*cells)[81], uint8_t (*out)[81],
+                           solver_status_t *status, int n) {
+  simd_propagate<simd_avx2_vec>(cells, out, status, n);
+}
+
+const simd_kernel_t simd_avx2 = { "avx2", 16, propagate_avx2 };
+
+#else
+
+const simd_kernel_t simd_avx2 = { "avx2", 0, NULL };
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * The lockstep singles kernel, included by simd.cpp and simd_avx2.cpp.
+ *
+ * Written with GCC vector extensions on a vector of uint16_t lanes, so the
+ * one kernel becomes SSE2, AVX2 or plain code depending on the flags the
+ * file including it is built with.  V is the vector type.
+ */
+
+#ifndef SIMD_KERNEL_H
+#define SIMD_KERNEL_H
+
+#include <string.h>
+
+#include "simd.h"
+#include "units.h"
+
+/* a in the lanes where mask is all ones, b in the others. */
+template <typename V>
+static inline V simd_choose(V mask, V a, V b) {
+  return (mask & a) | (~mask & b);
+}
+
+template <typename V>
+static void simd_propagate(const uint8_t (*cells)[81], uint8_t (*out)[81],
+                           solver_status_t *status, int n) {
+  V cand[81];
+  V zero = { };
+  V all = zero + ALL_DIGITS;
+
+  // Unused lanes get an empty board, which nothing happens to
+  for (int c = 0; c < 81; c++) {
+    cand[c] = all;
+    for (int lane = 0; lane < n; lane++) {
+      uint8_t d = cells[lane][c];
+      if (d != 0) {
+        cand[c][lane] = 1 << (d - 1);
+      }
+    }
+  }
+
+  V bad = zero;  // set in the lanes found to clash
+  V changed;
+  do {
+    changed = zero;
+    for (int u = 0; u < 27; u++) {
+      const uint8_t *unit = board_units[u];
+
+      // Digits that are placed once or more, and twice or more, in the
+      // unit, and digits that are possible in one cell or more, and two
+      // or more
+      V placed = zero, placed_twice = zero, once = zero, twice = zero;
+      for (int k = 0; k < 9; k++) {
+        V m = cand[unit[k]];
+        V single = (V) (((m & (m - 1)) == 0) & (m != 0));
+        V s = m & single;
+        placed_twice |= placed & s;
+        placed |= s;
+        twice |= once & m;
+        once |= m;
+      }
+      bad |= (V) (placed_twice != 0);
+      bad |= (V) (once != all);
+      V hidden = once & ~twice;  // digits with one place left
+
+      for (int k = 0; k < 9; k++) {
+        V m = cand[unit[k]];
+        V single = (V) (((m & (m - 1)) == 0) & (m != 0));
+        V nm = simd_choose(single, m, m & ~placed);
+        V h = nm & hidden;
+        nm = simd_choose((V) (h != 0), h, nm);
+        bad |= (V) (nm == 0);
+        changed |= nm ^ m;
+        cand[unit[k]] = nm;
+      }
+    }
+
+    // Stop once nothing changes in any lane still worth working on
+    changed &= ~bad;
+  } while (memcmp(&changed, &zero, sizeof(V)) != 0);
+
+  for (int lane = 0; lane < n; lane++) {
+    if (bad[lane] != 0) {
+      status[lane] = SOLVER_UNSOLVABLE;
+      continue;
+    }
+    bool complete = true;
+    for (int c = 0; c < 81; c++) {
+      uint16_t m = cand[c][lane];
+      if ((m & (m - 1)) == 0) {
+        out[lane][c] = __builtin_ctz(m) + 1;
+      } else {
+        out[lane][c] = 0;
+        complete = false;
+      }
+    }
+    status[lane] = complete ? SOLVER_SOLVED : SOLVER_RUNNING;
+  }
+}
+
+#endif
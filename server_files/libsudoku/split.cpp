@@ -0,0 +1,212 @@
+/*
+ * Parallel search of a single board.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <string.h>
+
+#include "split.h"
+#include "engine.h"
+#include "pool.h"
+
+#define SPLIT_PER_WORKER 8     // subproblems to aim for, per worker
+#define SPLIT_SLICE 2048       // nodes searched between looks at the stop flag
+
+typedef struct {
+  long limit;                 // solutions to stop at when counting, 0 for all
+  bool counting;
+  std::atomic<bool> stop;
+  std::atomic<long> count;
+  std::atomic<uint64_t> nodes;
+
+  std::mutex lock;            // guards solution and pending
+  std::condition_variable finished;
+  bool solved;
+  uint8_t solution[81];
+  int pending;                // tasks not finished yet
+} split_job_t;
+
+typedef struct {
+  split_job_t *job;
+  uint8_t cells[81];
+} split_task_t;
+
+/* Finds the empty cell with the fewest candidates.
+ *
+ * Returns the cell, with its candidates in *cand; -1 if the board is full;
+ * or -2 if a cell has no candidates left or the givens clash.
+ */
+static int branch_cell(const uint8_t cells[81], uint16_t *cand) {
+  uint16_t rows[9], cols[9], boxes[9];
+  if (!engine_givens(cells, rows, cols, boxes)) {
+    return -2;
+  }
+
+  int best = -1, best_count = 10;
+  for (int i = 0; i < 81; i++) {
+    if (cells[i] != 0) {
+      continue;
+    }
+    int r = i / 9, c = i % 9, b = (r / 3) * 3 + c / 3;
+    uint16_t m = ~(rows[r] | cols[c] | boxes[b]) & 0x1FF;
+    int count = __builtin_popcount(m);
+    if (count < best_count) {
+      best = i;
+      best_count = count;
+      *cand = m;
+      if (count == 0) {
+        return -2;
+      }
+    }
+  }
+  return best;
+}
+
+/* Fills in the first branching cells, breadth first, until there are
+ * target subproblems.  Dead ends are dropped on the way.  tasks has room
+ * for target + 8 boards: the boards already expanded are dropped from the
+ * front when the next ones would not fit.
+ *
+ * Returns the number of subproblems in tasks.
+ */
+static int split(const uint8_t cells[81], split_task_t *tasks, int target) {
+  int head = 0, n = 1;
+  memcpy(tasks[0].cells, cells, 81);
+  while (head < n && n - head < target) {
+    uint16_t cand;
+    int cell = branch_cell(tasks[head].cells, &cand);
+    if (cell == -1) {
+      break;  // solved already; search it as it is
+    }
+    if (cell == -2) {
+      head++;  // no solution this way
+      continue;
+    }
+    if (n + 9 > target + 8) {
+      memmove(tasks, tasks + head, (n - head) * sizeof(split_task_t));
+      n -= head;
+      head = 0;
+    }
+    for (int d = 1; d <= 9; d++) {
+      if (cand & (1 << (d - 1))) {
+        memcpy(tasks[n].cells, tasks[head].cells, 81);
+        tasks[n].cells[cell] = d;
+        n++;
+      }
+    }
+    head++;
+  }
+
+  // The expanded boards at the front are finished with; keep the rest
+  memmove(tasks, tasks + head, (n - head) * sizeof(split_task_t));
+  return n - head;
+}
+
+/* Records a solution.  Returns true if the search should stop. */
+static bool found(split_job_t *job, const uint8_t cells[81]) {
+  long n = ++job->count;
+  {
+    std::lock_guard<std::mutex> hold(job->lock);
+    if (!job->solved) {
+      job->solved = true;
+      memcpy(job->solution, cells, 81);
+    }
+  }
+  return !job->counting || (job->limit != 0 && n >= job->limit);
+}
+
+/* A pool task: searches one subproblem, a slice at a time. */
+static void search_task(void *arg) {
+  split_task_t *t = (split_task_t *) arg;
+  split_job_t *job = t->job;
+
+  board_solver_t s;
+  board_solver_begin(&s, t->cells);
+  while (!job->stop) {
+    solver_status_t status = board_solver_run(&s, SPLIT_SLICE);
+    if (status == SOLVER_UNSOLVABLE) {
+      break;
+    }
+    if (status == SOLVER_SOLVED) {
+      if (found(job, s.cells)) {
+        job->stop = true;
+        break;
+      }
+      board_solver_resume(&s);
+    }
+  }
+  job->nodes += s.nodes;
+
+  std::lock_guard<std::mutex> hold(job->lock);
+  if (--job->pending == 0) {
+    job->finished.notify_all();
+  }
+}
+
+/* Runs the search and waits for every task to finish.  The subproblems
+ * belong to the job, as a worker helping out may start another job before
+ * this one's are all taken.
+ */
+static void run_job(split_job_t *job, const uint8_t cells[81]) {
+  int target = pool_size() * SPLIT_PER_WORKER;
+  std::unique_ptr<split_task_t[]> tasks(new split_task_t[target + 8]);
+  job->stop = false;
+  job->count = 0;
+  job->nodes = 0;
+  job->solved = false;
+
+  int n = split(cells, tasks.get(), target);
+  job->pending = n;
+  if (n == 0) {
+    return;
+  }
+  for (int i = 0; i < n; i++) {
+    tasks[i].job = job;
+    pool_submit(search_task, &tasks[i]);
+  }
+
+  // A worker waiting would leave its own deque to be stolen from, so it
+  // works through the tasks too
+  if (pool_worker() >= 0) {
+    for (;;) {
+      {
+        std::lock_guard<std::mutex> hold(job->lock);
+        if (job->pending == 0) {
+          return;
+        }
+      }
+      if (!pool_help()) {
+        std::this_thread::yield();
+      }
+    }
+  }
+  std::unique_lock<std::mutex> hold(job->lock);
+  job->finished.wait(hold, [job] { return job->pending == 0; });
+}
+
+solver_status_t split_solve(const uint8_t cells[81], uint8_t out[81], uint64_t *nodes) {
+  split_job_t job;
+  job.counting = false;
+  job.limit = 1;
+  run_job(&job, cells);
+  *nodes += job.nodes;
+  if (!job.solved) {
+    return SOLVER_UNSOLVABLE;
+  }
+  memcpy(out, job.solution, 81);
+  return SOLVER_SOLVED;
+}
+
+long split_count(const uint8_t cells[81], long limit, uint64_t *nodes) {
+  split_job_t job;
+  job.counting = true;
+  job.limit = limit;
+  run_job(&job, cells);
+  *nodes += job.nodes;
+  long count = job.count;
+  return limit != 0 && count > limit ? limit : count;
+}
@@ -0,0 +1,31 @@
+/*
+ * Parallel search of a single board.
+ *
+ * The top of the search tree is expanded breadth first, always branching
+ * on the cell with the fewest candidates, until there are several
+ * subproblems for each worker in the pool (pool.h).  Each subproblem is a
+ * copy of the board with those cells filled in, and is searched as a pool
+ * task by the bitmask solver, in slices; idle workers steal the ones not
+ * started yet.  Between slices every task checks a shared flag, which is
+ * set as soon as a solution is found (or, when counting, once the limit is
+ * reached), so the others stop early.
+ *
+ * The pool must have been started.
+ */
+
+#ifndef SPLIT_H
+#define SPLIT_H
+
+#include <stdint.h>
+
+#include "board_solver.h"
+
+/* As engine_solve(), on all the pool's workers.  With more than one
+ * solution, which one is found first can change from run to run.
+ */
+solver_status_t split_solve(const uint8_t cells[81], uint8_t out[81], uint64_t *nodes);
+
+/* As engine_count(), on all the pool's workers. */
+long split_count(const uint8_t cells[81], long limit, uint64_t *nodes);
+
+#endif
@@ -0,0 +1,529 @@
+/*
+ * Batch solver: solves a file of puzzles, one per line.
+ *
+ *   sudoku_batch [-q] [-e bitmask|dlx] [-b auto|avx2|generic|scalar]
+ *                [-c limit | -g] [-j threads [-s | -P]] [file]
+ *
+ * Each line holds a puzzle as its first 81 characters, row by row, with
+ * 1-9 for givens and 0 or . for empty cells; anything after them is
+ * ignored, as are blank lines and lines starting with '#'.  For each
+ * puzzle, in order, one line goes to stdout: the solution, or the puzzle
+ * followed by " unsolvable" or " invalid".  -q leaves the solutions out.
+ * When done, stderr gets the number of puzzles, failures, search nodes
+ * and puzzles per second.
+ *
+ * -e picks the solver (see engine.h), so both can be timed on the same
+ * file.  -b solves several puzzles at a time in vector registers (see
+ * simd.h), with "auto" for the widest kernel the CPU has; the puzzles
+ * that need a search finish on the -e solver.  -c counts the solutions of
+ * each puzzle instead, up to limit (0 for all of them), and writes the
+ * puzzle followed by the count.  -g grades each puzzle by the techniques a
+ * person would need (see grader.h) and writes the puzzle followed by its
+ * rating and hardest technique, or " ungraded" (counted as unsolvable) if
+ * it does not have exactly one solution; at the end, the steps taken with
+ * each technique and the boards it was the hardest for are printed.
+ *
+ * -j solves on a pool of threads (0 for one per CPU, see pool.h).  The
+ * puzzles are handed out in blocks; blocks solved out of turn wait in a
+ * ring of slots until the ones before them are written, so the output
+ * stays in order.  Each thread's share of the work is printed at the end.
+ * With -s the threads work on one puzzle at a time instead, each taking
+ * part of its search (see split.h), for files of a few very hard puzzles.
+ * With -P they race the solvers against each other on each puzzle in turn
+ * (see portfolio.h; one thread per solver unless -j says otherwise), and
+ * the races each solver won are printed at the end.
+ *
+ * A file (or stdin, when it is a regular file) is mapped into memory and
+ * the puzzles are read straight out of the mapping, which is kept until
+ * the last block is written.  Pipes are read in large blocks, and only
+ * their lines are copied, into the block that solves them.  The blocks are
+ * allocated once at the start, so the size of the file is not a limit.
+ */
+
+#include <condition_variable>
+#include <errno.h>
+#include <fcntl.h>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "engine.h"
+#include "grader.h"
+#include "pool.h"
+#include "portfolio.h"
+#include "simd.h"
+#include "split.h"
+
+#define READ_BLOCK (1 << 20)
+#define BLOCK_LINES 256
+#define BLOCK_OUT (BLOCK_LINES * 104)  // the longest result line is 101
+#define SLOTS_PER_THREAD 4
+
+typedef struct {
+  bool quiet;
+  bool count;
+  long limit;
+  bool grade;
+  bool lockstep;  // solve simd_lanes() puzzles at a time
+  int threads;    // 1 to solve on the main thread, without the pool
+  bool split;     // the pool works on each puzzle in turn, not on blocks
+  bool race;      // ... racing the solvers on it
+} options_t;
+
+/* The puzzle lines in a block, solved together on one thread. */
+typedef struct {
+  int n_lines;
+  const char *line[BLOCK_LINES];  // the start of each line
+  uint8_t len[BLOCK_LINES];
+  char copy[BLOCK_LINES][81];     // the lines themselves, when read from a pipe
+
+  char out[BLOCK_OUT];
+  size_t out_len;
+  uint64_t unsolvable;
+  uint64_t invalid;
+  uint64_t nodes;
+  uint64_t steps[GRADE_TECHNIQUES];    // with -g, taken with each technique
+  uint64_t hardest[GRADE_TECHNIQUES];  // ... and boards it was the hardest for
+
+  bool done;  // solved, waiting to be written; under done_lock
+} block_t;
+
+typedef struct {
+  block_t *slots;
+  int n_slots;
+  bool copy_lines;   // the lines are in a buffer that is reused, not a mapping
+  uint64_t filled;   // blocks handed out so far; slots[filled % n_slots] fills next
+  uint64_t written;  // blocks written so far, in order
+  uint64_t puzzles;
+  uint64_t unsolvable;
+  uint64_t invalid;
+  uint64_t nodes;
+  uint64_t steps[GRADE_TECHNIQUES];
+  uint64_t hardest[GRADE_TECHNIQUES];
+} batch_t;
+
+static options_t opt;
+
+static std::mutex done_lock;
+static std::condition_variable block_done;
+
+static void out_write(block_t *k, const char *s, size_t n) {
+  memcpy(k->out + k->out_len, s, n);
+  k->out_len += n;
+}
+
+/* Reads a puzzle from the first 81 characters of a line.
+ *
+ * Returns false if the line is too short or holds something else.
+ */
+static bool parse_puzzle(const char *line, size_t len, uint8_t cells[81]) {
+  if (len < 81) {
+    return false;
+  }
+  for (int i = 0; i < 81; i++) {
+    char c = line[i];
+    if (c >= '1' && c <= '9') {
+      cells[i] = c - '0';
+    } else if (c == '0' || c == '.') {
+      cells[i] = 0;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Writes the puzzle followed by the number of solutions it has. */
+static void count_line(block_t *k, const char *line, const uint8_t cells[81]) {
+  long n = opt.split ? split_count(cells, opt.limit, &k->nodes)
+                     : engine_count(cells, opt.limit, &k->nodes);
+  if (n == 0) {
+    k->unsolvable++;
+  }
+  if (!opt.quiet) {
+    char text[24];
+    int len = snprintf(text, sizeof(text), " %ld\n", n);
+    out_write(k, line, 81);
+    out_write(k, text, len);
+  }
+}
+
+/* Writes the puzzle followed by its rating and hardest technique. */
+static void grade_line(block_t *k, const char *line, const uint8_t cells[81]) {
+  grade_t g;
+  char text[40];
+  int len;
+  if (!grade_board(cells, &g)) {
+    k->unsolvable++;
+    len = snprintf(text, sizeof(text), " ungraded\n");
+  } else {
+    for (int t = 0; t < GRADE_TECHNIQUES; t++) {
+      k->steps[t] += g.uses[t];
+    }
+    k->hardest[g.hardest]++;
+    len = snprintf(text, sizeof(text), " %d %s\n", g.rating, grade_technique_name(g.hardest));
+  }
+  if (!opt.quiet) {
+    out_write(k, line, 81);
+    out_write(k, text, len);
+  }
+}
+
+/* Writes the result for one line: the solution, or the start of the line
+ * and what went wrong.  valid is false if the line is not a puzzle.
+ */
+static void write_result(block_t *k, const char *line, size_t len, bool valid,
+                         solver_status_t status, const uint8_t cells[81]) {
+  const char *failure = NULL;
+  if (!valid) {
+    k->invalid++;
+    failure = " invalid\n";
+  } else if (status != SOLVER_SOLVED) {
+    k->unsolvable++;
+    failure = " unsolvable\n";
+  }
+  if (opt.quiet) {
+    return;
+  }
+
+  if (failure != NULL) {
+    out_write(k, line, len);
+    out_write(k, failure, strlen(failure));
+    return;
+  }
+  char solution[82];
+  for (int i = 0; i < 81; i++) {
+    solution[i] = '0' + cells[i];
+  }
+  solution[81] = '\n';
+  out_write(k, solution, sizeof(solution));
+}
+
+/* Solves lines first to first + n - 1 of a block in lockstep. */
+static void solve_lockstep(block_t *k, int first, int n) {
+  uint8_t boards[SIMD_MAX_LANES][81];
+  bool valid[SIMD_MAX_LANES];
+  int n_boards = 0;
+  for (int i = 0; i < n; i++) {
+    valid[i] = parse_puzzle(k->line[first + i], k->len[first + i], boards[n_boards]);
+    n_boards += valid[i];
+  }
+
+  solver_status_t status[SIMD_MAX_LANES];
+  simd_solve(boards, boards, status, n_boards, &k->nodes);
+  int board = 0;
+  for (int i = 0; i < n; i++) {
+    int line = first + i;
+    if (valid[i]) {
+      write_result(k, k->line[line], k->len[line], true, status[board], boards[board]);
+      board++;
+    } else {
+      write_result(k, k->line[line], k->len[line], false, SOLVER_UNSOLVABLE, NULL);
+    }
+  }
+}
+
+/* Solves every line of a block into its output. */
+static void solve_block(block_t *k) {
+  k->out_len = 0;
+  k->unsolvable = 0;
+  k->invalid = 0;
+  k->nodes = 0;
+
+  if (opt.lockstep) {
+    int lanes = simd_lanes();
+    for (int first = 0; first < k->n_lines; first += lanes) {
+      int n = k->n_lines - first;
+      solve_lockstep(k, first, n < lanes ? n : lanes);
+    }
+    return;
+  }
+
+  for (int i = 0; i < k->n_lines; i++) {
+    uint8_t cells[81];
+    if (!parse_puzzle(k->line[i], k->len[i], cells)) {
+      write_result(k, k->line[i], k->len[i], false, SOLVER_UNSOLVABLE, NULL);
+    } else if (opt.count) {
+      count_line(k, k->line[i], cells);
+    } else if (opt.grade) {
+      grade_line(k, k->line[i], cells);
+    } else {
+      solver_status_t status;
+      if (opt.race) {
+        status = portfolio_solve(cells, cells, &k->nodes, NULL);
+      } else if (opt.split) {
+        status = split_solve(cells, cells, &k->nodes);
+      } else {
+        status = engine_solve(cells, cells, &k->nodes);
+      }
+      write_result(k, k->line[i], k->len[i], true, status, cells);
+    }
+  }
+}
+
+/* A pool task: solves a block and tells the main thread. */
+static void solve_task(void *arg) {
+  block_t *k = (block_t *) arg;
+  solve_block(k);
+  {
+    std::lock_guard<std::mutex> hold(done_lock);
+    k->done = true;
+  }
+  block_done.notify_one();
+}
+
+/* Writes a solved block out, adds up its counts and frees its slot. */
+static void write_block(batch_t *b, block_t *k) {
+  if (k->out_len > 0 && fwrite(k->out, 1, k->out_len, stdout) != k->out_len) {
+    perror("sudoku_batch: write");
+    exit(1);
+  }
+  b->unsolvable += k->unsolvable;
+  b->invalid += k->invalid;
+  b->nodes += k->nodes;
+  for (int t = 0; t < GRADE_TECHNIQUES; t++) {
+    b->steps[t] += k->steps[t];
+    b->hardest[t] += k->hardest[t];
+    k->steps[t] = 0;
+    k->hardest[t] = 0;
+  }
+  k->n_lines = 0;
+  k->done = false;
+  b->written++;
+}
+
+/* Writes the solved blocks that are next in order.  With wait, waits for
+ * the first of them to be solved.
+ */
+static void write_ready(batch_t *b, bool wait) {
+  while (b->written < b->filled) {
+    block_t *k = &b->slots[b->written % b->n_slots];
+    {
+      std::unique_lock<std::mutex> hold(done_lock);
+      if (wait) {
+        block_done.wait(hold, [k] { return k->done; });
+        wait = false;
+      } else if (!k->done) {
+        return;
+      }
+    }
+    write_block(b, k);
+  }
+}
+
+/* Hands the block being filled over to be solved, and makes sure the next
+ * slot is free to fill.
+ */
+static void submit_block(batch_t *b) {
+  block_t *k = &b->slots[b->filled % b->n_slots];
+  if (k->n_lines == 0) {
+    return;
+  }
+  b->filled++;
+  if (opt.threads == 1 || opt.split || opt.race) {
+    solve_block(k);
+    write_block(b, k);
+    return;
+  }
+  pool_submit(solve_task, k);
+  write_ready(b, b->filled - b->written == (uint64_t) b->n_slots);
+}
+
+/* Hands over the last block and writes out every block still solving. */
+static void finish_blocks(batch_t *b) {
+  submit_block(b);
+  while (b->written < b->filled) {
+    write_ready(b, true);
+  }
+}
+
+/* Adds the puzzle on one line, without its newline, to the block. */
+static void add_line(batch_t *b, const char *line, size_t len) {
+  if (len > 0 && line[len - 1] == '\r') {
+    len--;
+  }
+  if (len == 0 || line[0] == '#') {
+    return;
+  }
+  b->puzzles++;
+
+  block_t *k = &b->slots[b->filled % b->n_slots];
+  k->len[k->n_lines] = len < 81 ? len : 81;
+  if (b->copy_lines) {
+    memcpy(k->copy[k->n_lines], line, k->len[k->n_lines]);
+    line = k->copy[k->n_lines];
+  }
+  k->line[k->n_lines] = line;
+  if (++k->n_lines == BLOCK_LINES) {
+    submit_block(b);
+  }
+}
+
+/* Adds every line in [p, end); a last line without a newline counts. */
+static void add_lines(batch_t *b, const char *p, const char *end) {
+  while (p < end) {
+    const char *nl = (const char *) memchr(p, '\n', end - p);
+    const char *line_end = nl != NULL ? nl : end;
+    add_line(b, p, line_end - p);
+    p = line_end + 1;
+  }
+}
+
+/* Reads a file through a read only mapping of it, which the blocks point
+ * into until they are all written.  Returns false if it cannot be mapped,
+ * eg. because it is a pipe.
+ */
+static bool read_mapped(batch_t *b, int fd) {
+  struct stat st;
+  if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+    return false;
+  }
+  if (st.st_size == 0) {
+    return true;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+  const char *p = (const char *) map;
+  add_lines(b, p, p + st.st_size);
+  finish_blocks(b);
+  munmap(map, st.st_size);
+  return true;
+}
+
+/* Reads what comes down a pipe, a block at a time.  A line cut off at the
+ * end of a block is moved to the front before the next read.
+ */
+static void read_stream(batch_t *b, int fd) {
+  static char buf[READ_BLOCK];
+  size_t len = 0;
+  b->copy_lines = true;
+  for (;;) {
+    ssize_t n = read(fd, buf + len, sizeof(buf) - len);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      perror("sudoku_batch: read");
+      exit(1);
+    }
+    if (n == 0) {
+      add_lines(b, buf, buf + len);  // last line, without a newline
+      return;
+    }
+    len += n;
+
+    const char *last_nl = (const char *) memrchr(buf, '\n', len);
+    if (last_nl == NULL) {
+      if (len == sizeof(buf)) {
+        add_line(b, buf, len);  // a line longer than the buffer
+        len = 0;
+      }
+      continue;
+    }
+    add_lines(b, buf, last_nl + 1);
+    size_t rest = buf + len - (last_nl + 1);
+    memmove(buf, last_nl + 1, rest);
+    len = rest;
+  }
+}
+
+int main(int argc, char **argv) {
+  const char *path = NULL;
+  opt.threads = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-q") == 0) {
+      opt.quiet = true;
+    } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+      if (!engine_select_name(argv[++i])) {
+        fprintf(stderr, "sudoku_batch: no solver called %s\n", argv[i]);
+        return 2;
+      }
+    } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+      if (!simd_select_name(argv[++i])) {
+        fprintf(stderr, "sudoku_batch: no batch kernel %s on this CPU\n", argv[i]);
+        return 2;
+      }
+      opt.lockstep = true;
+    } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      opt.count = true;
+      opt.limit = atol(argv[++i]);
+    } else if (strcmp(argv[i], "-g") == 0) {
+      opt.grade = true;
+    } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      opt.threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0) {
+      opt.split = true;
+    } else if (strcmp(argv[i], "-P") == 0) {
+      opt.race = true;
+    } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      fprintf(stderr, "usage: %s [-q] [-e bitmask|dlx] [-b auto|avx2|generic|scalar] "
+              "[-c limit | -g] [-j threads [-s | -P]] [file]\n", argv[0]);
+      return 2;
+    } else {
+      path = argv[i];
+    }
+  }
+
+  int fd = 0;
+  if (path != NULL && strcmp(path, "-") != 0) {
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+      fprintf(stderr, "sudoku_batch: %s: %s\n", path, strerror(errno));
+      return 1;
+    }
+  }
+
+  if (opt.lockstep + opt.split + opt.race > 1 || (opt.count && (opt.lockstep || opt.race)) ||
+      (opt.grade && (opt.count || opt.lockstep || opt.split || opt.race))) {
+    fprintf(stderr, "sudoku_batch: only one of -b, -s and -P, -c not with -b or -P, "
+            "and -g with none of them\n");
+    return 2;
+  }
+
+  double start = engine_seconds();
+  static batch_t b;
+  if (opt.race && opt.threads == 1) {
+    opt.threads = PORTFOLIO_SOLVERS;
+  }
+  if (opt.threads != 1 || opt.split || opt.race) {
+    opt.threads = pool_start(opt.threads);
+  }
+  b.n_slots = opt.threads * SLOTS_PER_THREAD;
+  b.slots = (block_t *) calloc(b.n_slots, sizeof(block_t));
+
+  if (!read_mapped(&b, fd)) {
+    read_stream(&b, fd);
+  }
+  finish_blocks(&b);
+  fflush(stdout);
+  double took = engine_seconds() - start;
+
+  fprintf(stderr, "%s%s%s: %llu puzzles, %llu unsolvable, %llu invalid, %llu nodes, "
+          "%.3f s, %.0f puzzles/s\n", opt.lockstep ? simd_name() : "",
+          opt.lockstep ? "+" : "", opt.race ? "portfolio" : opt.grade ? "grader" : engine_name(),
+          (unsigned long long) b.puzzles, (unsigned long long) b.unsolvable,
+          (unsigned long long) b.invalid, (unsigned long long) b.nodes, took,
+          took > 0 ? b.puzzles / took : 0.0);
+  if (opt.threads != 1 || opt.split || opt.race) {
+    pool_stop();
+    pool_report(stderr);
+  }
+  if (opt.race) {
+    portfolio_report(stderr);
+  }
+  if (opt.grade) {
+    fprintf(stderr, "technique,steps,hardest\n");
+    for (int t = 0; t < GRADE_TECHNIQUES; t++) {
+      fprintf(stderr, "%s,%llu,%llu\n", grade_technique_name((grade_technique_t) t),
+              (unsigned long long) b.steps[t], (unsigned long long) b.hardest[t]);
+    }
+  }
+  return b.unsolvable + b.invalid > 0 ? 1 : 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * Puzzle generator: writes boards with exactly one solution, one per line.
+ *
+ *   sudoku_gen [-s] [-n boards] [-r seed] [-e bitmask|dlx] [-d easy|medium|hard] hints
+ *
+ * Each board is made by generator.cpp, emptying a random solved board
+ * down to hints hints (0 for minimal boards), in symmetric pairs with -s.
+ * The boards go to stdout in sudoku_batch's format, 0 for an empty cell,
+ * followed by the number of hints they ended with.  -n makes that many
+ * boards (1 by default), and -r starts from a seed, so a run can be
+ * repeated.  -e picks the solver for the uniqueness checks (see engine.h).
+ * -d keeps making boards until one is graded in the band asked for (see
+ * grader.h), and writes its rating after the hints.
+ *
+ * When done, stderr gets the average hints, the uniqueness checks made
+ * and boards made (more than one only with -d) for each board, and the
+ * time taken for each board: the mean and the slowest, which is what a
+ * 'G' request waits for.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "engine.h"
+#include "generator.h"
+
+int main(int argc, char **argv) {
+  bool symmetric = false;
+  long boards = 1;
+  uint32_t seed = (uint32_t) time(NULL);
+  int hints = -1;
+  int band = -1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-s") == 0) {
+      symmetric = true;
+    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      boards = atol(argv[++i]);
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      seed = (uint32_t) strtoul(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+      if (!engine_select_name(argv[++i])) {
+        fprintf(stderr, "sudoku_gen: no solver called %s\n", argv[i]);
+        return 2;
+      }
+    } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+      const char *bands[] = { "easy", "medium", "hard" };
+      for (int k = 0; k < 3; k++) {
+        if (strcmp(argv[i + 1], bands[k]) == 0) {
+          band = k;
+        }
+      }
+      if (band < 0) {
+        hints = -1;
+        break;
+      }
+      i++;
+    } else if (argv[i][0] != '-' && hints < 0) {
+      hints = atoi(argv[i]);
+    } else {
+      hints = -1;
+      break;
+    }
+  }
+  if (hints < 0 || hints > 81) {
+    fprintf(stderr, "usage: %s [-s] [-n boards] [-r seed] [-e bitmask|dlx] "
+            "[-d easy|medium|hard] hints\n", argv[0]);
+    return 2;
+  }
+
+  uint32_t state = seed != 0 ? seed : 0x9E3779B9;
+  long total_hints = 0, total_calls = 0, total_tries = 0;
+  double total_seconds = 0, slowest = 0;
+  for (long n = 0; n < boards; n++) {
+    uint8_t cells[81];
+    gen_stats_t stats;
+    if (band < 0) {
+      gen_unique(hints, symmetric, &state, cells, &stats);
+    } else {
+      gen_graded(hints, (grade_band_t) band, symmetric, &state, cells, &stats);
+    }
+
+    char line[81];
+    for (int c = 0; c < 81; c++) {
+      line[c] = '0' + cells[c];
+    }
+    if (band < 0) {
+      printf("%.81s %d\n", line, stats.hints);
+    } else {
+      printf("%.81s %d %d\n", line, stats.hints, stats.rating);
+    }
+
+    total_hints += stats.hints;
+    total_calls += stats.solver_calls;
+    total_tries += stats.tries;
+    total_seconds += stats.seconds;
+    if (stats.seconds > slowest) {
+      slowest = stats.seconds;
+    }
+  }
+  fflush(stdout);
+
+  double n = boards > 0 ? boards : 1;
+  fprintf(stderr, "%s%s: %ld boards, %.1f hints, %.1f solver calls, %.1f tries, "
+          "%.3f ms each, %.3f ms slowest\n", symmetric ? "symmetric " : "", engine_name(),
+          boards, total_hints / n, total_calls / n, total_tries / n,
+          total_seconds / n * 1e3, slowest * 1e3);
+  return 0;
+}
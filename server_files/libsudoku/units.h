@@ -0,0 +1,20 @@
+/*
+ * The board's rows, columns and boxes, as tables of cell numbers (0-80,
+ * row by row), for the solvers that keep candidates as bitmasks:
+ * counter.cpp, grader.cpp and the SIMD kernel.
+ */
+
+#ifndef UNITS_H
+#define UNITS_H
+
+#include <stdint.h>
+
+#define ALL_DIGITS 0x1FF  // a candidate bitmask with every digit, bit d - 1 for d
+
+/* The cells of each unit: the rows, then the columns, then the boxes. */
+extern const uint8_t board_units[27][9];
+
+/* The 20 other cells sharing a row, column or box with each cell. */
+extern const uint8_t board_peers[81][20];
+
+#endif
@@ -3,6 +3,7 @@ import time
 sys.setrecursionlimit(30000)
 from adjacencygraph import UndirectedAdjacencyGraph
 import random
+import libsudoku  # native solver, used instead of solve() when it is built
 
 def make_graph():
     '''
@@ -120,6 +121,8 @@ def solve_check(graph):
         1 if correct board
         0 if incorrect
     """
+    if libsudoku.available():
+        return libsudoku.check(board_colours(graph))
     for v in graph.vertices():
         for w in graph.neighbours(v):
             if graph.colour(w)==graph.colour(v):
@@ -195,36 +198,154 @@ def solve(graph):
                 graph.add_colour(v, 0) # O(1)
         return False  # backtracking if needed
 
+def board_colours(graph):
+    """
+    The colours of the graph as a list, in vertex order (row by row).
+    """
+    return [graph.colour(v) for v in range(1,82)]
+
+def solve_board(graph):
+    """
+    Solves a sudoku board represented by a graph, in place. Uses the native
+        solver when it is built, which solves any board in well under a
+        millisecond; otherwise solve(), which gives up after 5 seconds.
+        The caller sets t before calling, for solve()'s time limit.
+
+    Parameters:
+        graph: the current graph object to be solved
+
+    Returns:
+        True if graph is solved correctly
+        False if graph cannot be solved
+    """
+    if not libsudoku.available():
+        return solve(graph)
+    solution = libsudoku.solve(board_colours(graph))
+    if solution is None:
+        return False
+    add_colours(graph, solution)
+    return True
+
+def count_solutions(graph, limit=2):
+    """
+    Counts the solutions of a sudoku board represented by a graph, stopping
+        as soon as limit are found (0 for no limit). With the default limit
+        of 2 it tells whether the board has exactly one solution. Uses the
+        native solver when it is built; otherwise backtracks like solve(),
+        leaving the graph as it was.
+
+    Parameters:
+        graph: the current graph object
+        limit: the most solutions worth counting
+
+    Returns:
+        The number of solutions found, at most limit
+    """
+    if libsudoku.available():
+        return libsudoku.count_solutions(board_colours(graph), limit)
+    solved = find_empty_spot(graph)
+    if not solved[0]:
+        return 1
+    v = solved[1]
+    count = 0
+    for colour in range(1,10):
+        if check_posibility(graph, v, colour):
+            graph.add_colour(v, colour)
+            count += count_solutions(graph, limit - count if limit else 0)
+            graph.add_colour(v, 0)
+            if limit and count >= limit:
+                break
+    return count
+
+def is_unique(graph):
+    """
+    Returns:
+        True if the board has exactly one solution
+    """
+    return count_solutions(graph, 2) == 1
+
+# Solved boards generate_solved_board() starts from, the same as
+# libsudoku/generator.cpp's
+SEED_GRIDS = [
+    "813627594749358261526419387365194872972835146481762935138276459654981723297543618",
+    "642951378519783426378246915983567241126894537457312689261479853735628194894135762",
+    "149367852578192634326485971463271589912856743785934216257613498834729165691548327",
+    "395124876247683591816795342683571924952846713174239658461958237528317469739462185",
+]
+
+def shuffled_lines():
+    """
+    A random order for the rows (or columns) of a board that keeps each band
+        (or stack) of three together: the bands shuffled, and the rows within
+        each band.
+
+    Returns:
+        The rows, 0-8, in their new order
+    """
+    return [3*band + row for band in random.sample(range(3), 3)
+            for row in random.sample(range(3), 3)]
+
 def generate_solved_board():
     """
     Generates a random solved board to be used in conjuction with generate_board
-        to create a random sudoku board for the game.
+        to create a random sudoku board for the game. No search: one of
+        SEED_GRIDS has its rows and columns shuffled within bands and stacks,
+        the bands and stacks shuffled, the digits relabelled and is turned on
+        its diagonal half the time, none of which can break a row, column or
+        box.
+
+    Complexity: O(|V|)
 
     Returns:
         The randomly solved graph to be used in generate_board
     """
+    seed = random.choice(SEED_GRIDS)
+    rows = shuffled_lines()
+    cols = shuffled_lines()
+    relabel = [0] + random.sample(range(1,10), 9)
+    transpose = random.random() < 0.5
+    colours = []
+    for r in range(9):
+        for c in range(9):
+            if transpose:
+                colours.append(relabel[int(seed[9*cols[c] + rows[r]])])
+            else:
+                colours.append(relabel[int(seed[9*rows[r] + cols[c]])])
     graph = make_graph()
-    v_list=random.sample(graph.vertices(), 9)
-    counter = 1
-    for v in v_list:  # O(9)
-        graph.add_colour(v, counter)
-        counter+=1
-    if solve(graph):
-        return graph
-    else:
-        return generate_solved_board()
+    add_colours(graph, colours)
+    return graph
 
 def generate_board(difficulty):
     """
-    Generates a random sudoku board for the game.
+    Generates a random sudoku board for the game. With the native solver
+        the board has exactly one solution, and is graded by the techniques
+        a person would need: 60 hints (easy) gives a board that needs only
+        singles; 40 (medium) and 20 (hard) empty the board as far as it
+        stays unique and keep one that needs locked candidates or subsets,
+        or fish or guessing, respectively. The Python fallback empties
+        81-difficulty cells at once, which may leave several solutions. The
+        hints, solver calls, seconds and rating (-1 if not graded) are left
+        in last_generation.
 
     Returns:
         The colour list of the generated board.
     """
+    global last_generation
+    if libsudoku.available():
+        if difficulty >= 50:
+            band, hints = libsudoku.EASY, difficulty
+        else:
+            band = libsudoku.MEDIUM if difficulty >= 30 else libsudoku.HARD
+            hints = 0
+        colours, rating, calls, seconds = libsudoku.generate_graded(hints, band)
+        last_generation = (81 - colours.count(0), calls, seconds, rating)
+        return colours
+    start = time.time()
     graph = generate_solved_board()
-    v_list = random.sample(graph.vertices(), 81-difficulty)
+    v_list = random.sample(sorted(graph.vertices()), 81-difficulty)
     for v in v_list:
         graph.add_colour(v, 0)
+    last_generation = (difficulty, 0, time.time() - start, -1)
     return graph.colours()
 
 
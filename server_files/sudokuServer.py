@@ -20,7 +20,7 @@ import math # used for sqrt
 import sys   # used with stdin
 from cs_message import *  # used for serial communication with diagnostic msgs
 
-def server(serial_in, serial_out):
+def server(serial_in, serial_out, profile=False, trace=False):
     '''Acts as a sudoku server that accepts various requests ranging from board
     creation to solving a sudoku board. For a solve and check request, the
     entire current board is received via serial monitor from the arduino client
@@ -31,17 +31,34 @@ def server(serial_in, serial_out):
     Args:
         serial_in,serial_out(textserial objects): Serial channels for
         and recieving data
+        profile(bool): after each request, ask the client with 'P' to
+        print its profile, which arrives on stderr as diagnostic messages
+        trace(bool): likewise ask with 'T' for the client's event trace
     '''
     state = 0  # state 0 is waiting for input
     colours = [0]*81  # initialization of list to hold inputted and outputted graph colours
     count = 0  # loop counter
     graph = solver.make_graph()  # sudoku board graph representaton is created
+    if solver.libsudoku.available():
+        log_msg("Using the native solver")
+    else:
+        log_msg("libsudoku is not built, using the Python solver")
+    if get_recording() is not None:
+        send_msg_to_client(serial_out, "R")  # start recording the inputs
+    served = False  # a request came in since the client was last asked
 
     while True:
         while state == 0:  # state 0 is waiting for input from client
+            if served:
+                if profile:
+                    send_msg_to_client(serial_out, "P")
+                if trace:
+                    send_msg_to_client(serial_out, "T")
+                served = False
             log_msg("state 0")
             msg = receive_msg_from_client(serial_in)
             log_msg("state0 got {}".format(msg))
+            served = msg[0] in "CFG"
             if msg[0] == 'C':  # if C received, jump to check protocol
                 log_msg("server C")
                 while count < 81:  # recieve all 81 board cells
@@ -111,13 +128,12 @@ def server(serial_in, serial_out):
             t = time.time()  # timeout timer for solver function
             solver.t = t
             # solve the board - error is 0 if error occured
-            error = solver.solve(graph)
+            error = solver.solve_board(graph)
             log_msg(graph.colours())
             if not error:  # if error code was received, send error message to reset
                 state = 0
                 send_msg_to_client(serial_out, "-")  # send reset message to client
                 break
-            print(graph.colours())  #debug line for solved graph
 
             log_msg("sending?")
             send_msg_to_client(serial_out, "D")  # done task
@@ -148,6 +164,11 @@ def server(serial_in, serial_out):
             solver.t = t
             # create sudoku board with required difficulty
             new_colour_list = solver.generate_board(difficulty)
+            log_msg("generated {} hints, {} solver calls, {:.1f} ms, "
+                    "rating {}".format(solver.last_generation[0],
+                                       solver.last_generation[1],
+                                       solver.last_generation[2] * 1000,
+                                       solver.last_generation[3]))
 
             log_msg("sending colours")
             send_msg_to_client(serial_out, "D")  # done task
@@ -176,6 +197,22 @@ def server(serial_in, serial_out):
 
 
 
+def stop_recording(serial_out):
+    '''Asks the client to stop recording its inputs, if the server asked it
+    to start, and closes the recording with a line that stops its replay.
+    The client may be gone by now, so the request is only tried.
+
+    Args:
+        serial_out(textserial object): Serial channel to the client
+    '''
+    if get_recording() is None:
+        return
+    try:
+        send_msg_to_client(serial_out, "R")
+    except (OSError, ValueError):
+        pass  # the client or the channel is already gone
+    end_recording()
+
 
 if __name__ == "__main__":
     import argparse
@@ -194,6 +231,23 @@ if __name__ == "__main__":
         action="store_false",
         dest="debugOff")
 
+    parser.add_argument("-p",
+        help="Ask the client for its profile after each request",
+        action="store_true",
+        dest="profile")
+
+    parser.add_argument("-t",
+        help="Timestamp the log and ask the client for its trace after each\n"
+             "request; turn the log into a Chrome trace with trace2json.py",
+        action="store_true",
+        dest="trace")
+
+    parser.add_argument("-r",
+        help="Record the client's inputs into this file, to replay them\n"
+             "with HOST_INPUT on the host build",
+        type=argparse.FileType("w"),
+        dest="record")
+
     parser.add_argument("-s",
         help="Set serial port for protocol",
         nargs="?",
@@ -206,11 +260,13 @@ if __name__ == "__main__":
     d0 = args.debugOff
 
     set_logging(d0)
+    set_timestamps(args.trace)
+    set_recording(args.record)
 
-    import textserial
     serial_port_name = args.serial_port_name
 
     if serial_port_name != "0":
+        import textserial  # needs pyserial, which stdin/stdout mode does not
         log_msg("Opening serial port: {}".format(serial_port_name))
         # Open up the connection
         baudrate = 9600  # [bit/seconds] 115200 also works
@@ -226,8 +282,15 @@ if __name__ == "__main__":
 
         with textserial.TextSerial(
             serial_port_name, baudrate, errors='ignore', newline=None) as ser:
-            server(ser, ser) # runs the server
+            try:
+                server(ser, ser, args.profile, args.trace) # runs the server
+            finally:
+                stop_recording(ser)
 
     else:  # if no serial port use stdin and stdout
-        print("No serial port. Using stdin and stdout.")
-        server(sys.stdin, sys.stdout)
+        # stdout is the protocol channel here, so this goes to stderr
+        print("No serial port. Using stdin and stdout.", file=sys.stderr)
+        try:
+            server(sys.stdin, sys.stdout, args.profile, args.trace)
+        finally:
+            stop_recording(sys.stdout)
@@ -0,0 +1,154 @@
+'''
+trace2json.py
+
+Description: Turns the client's event trace, and the server's log around it,
+into a Chrome trace (JSON) that chrome://tracing or ui.perfetto.dev can show.
+
+The input is the stderr of "sudokuServer.py -t", where every line is stamped
+with the server's clock and the client's trace dumps arrive as diagnostic
+"D T ..." lines, or a TRACE.TXT file the client wrote to its SD card.  Each
+dump starts with the client's micros() at the time it was sent; the server's
+stamp on that line, less the time the line took on the serial line, gives the
+offset from the client's clock to the server's, so both show on one timeline.
+Without server stamps (an SD card file) the client's own clock is used.
+
+Usage: python3 trace2json.py [-o trace.json] [-b 9600] log...
+'''
+
+import json
+import sys
+
+SERVER_PID = 1
+CLIENT_PID = 2
+CLIENT_MAIN_TID = 1  # sections and moments on the client
+CLIENT_DIAG_TID = 2  # the client's other diagnostic messages
+
+
+def split_stamp(line):
+    '''Splits the server's timestamp off a log line.
+
+    Args:
+        line(str): a line of the log, without its new line
+
+    Returns:
+        (stamp, rest): the time in seconds, or None if the line has none,
+        and the rest of the line
+    '''
+    head, _, rest = line.partition(" ")
+    try:
+        return float(head), rest
+    except ValueError:
+        return None, line
+
+
+def unescape(msg):
+    '''Undoes cs_message.escape_nl(), and drops the client's \\r.'''
+    if msg.endswith("\\n"):
+        msg = msg[:-2]
+    return msg.rstrip("\r\n")
+
+
+def convert(lines, baud):
+    '''Builds the trace events from the lines of a log or a trace file.
+
+    Args:
+        lines(iterable of str): the lines, in the order they were written
+        baud(int): bits per second on the serial line, to know how long a
+            line took to arrive
+
+    Returns:
+        The list of Chrome trace events, with times in microseconds.
+    '''
+    events = []
+    offset = 0.0   # client seconds to server seconds, for the current dump
+    sync_us = 0    # client micros() at the start of the current dump
+
+    for line in lines:
+        stamp, rest = split_stamp(line.rstrip("\n"))
+        rest = unescape(rest)
+        if rest.startswith("L |"):  # the server's own log
+            if stamp is not None:
+                events.append({"name": rest[3:-1], "ph": "i", "s": "t",
+                               "ts": stamp * 1e6, "pid": SERVER_PID, "tid": 1})
+            continue
+
+        msg = rest[2:] if rest.startswith("D ") else rest
+        # time the line took to arrive: "D ", the message and "\r\n"
+        wire = (len(msg) + 4) * 10.0 / baud
+
+        if not msg.startswith("T "):
+            if stamp is not None and msg:
+                events.append({"name": msg, "ph": "i", "s": "t",
+                               "ts": (stamp - wire) * 1e6,
+                               "pid": CLIENT_PID, "tid": CLIENT_DIAG_TID})
+            continue
+
+        fields = msg.split(None, 3)
+        if fields[1] == "sync":
+            sync_us = int(fields[2])
+            offset = (stamp - wire if stamp is not None else 0.0) - sync_us / 1e6
+            continue
+        if fields[1] == "dropped":
+            print("trace2json: the client dropped {} events".format(fields[2]),
+                  file=sys.stderr)
+            continue
+        if len(fields) < 4:
+            continue
+
+        us = int(fields[1])
+        if us > sync_us:  # recorded before micros() wrapped around
+            us -= 1 << 32
+        event = {"name": fields[3], "ph": fields[2], "ts": (offset + us / 1e6) * 1e6,
+                 "pid": CLIENT_PID, "tid": CLIENT_MAIN_TID}
+        if event["ph"] == "I":
+            event["ph"] = "i"
+            event["s"] = "t"
+        elif event["ph"] in "be":  # server requests, drawn on their own row
+            event["cat"] = "request"
+            event["id"] = 1
+        events.append(event)
+
+    # Start the timeline at the first event
+    if events:
+        start = min(e["ts"] for e in events)
+        for e in events:
+            e["ts"] = round(e["ts"] - start, 1)
+
+    names = [(SERVER_PID, None, "server"), (CLIENT_PID, None, "client"),
+             (CLIENT_PID, CLIENT_MAIN_TID, "main"),
+             (CLIENT_PID, CLIENT_DIAG_TID, "diagnostics")]
+    for pid, tid, name in names:
+        if tid is None:
+            events.append({"name": "process_name", "ph": "M", "pid": pid,
+                           "args": {"name": name}})
+        else:
+            events.append({"name": "thread_name", "ph": "M", "pid": pid,
+                           "tid": tid, "args": {"name": name}})
+    return events
+
+
+if __name__ == "__main__":
+    import argparse
+    parser = argparse.ArgumentParser(
+        description='Client trace and server log to Chrome trace JSON.',
+        )
+    parser.add_argument("logs", nargs="*", default=["-"],
+        help="server log (stderr of sudokuServer.py -t) or TRACE.TXT")
+    parser.add_argument("-o", dest="output", default="-",
+        help="where to write the JSON (default stdout)")
+    parser.add_argument("-b", dest="baud", type=int, default=9600,
+        help="serial line speed (default 9600)")
+    args = parser.parse_args()
+
+    lines = []
+    for name in args.logs:
+        with (sys.stdin if name == "-" else open(name)) as f:
+            lines.extend(f.readlines())
+
+    trace = {"traceEvents": convert(lines, args.baud),
+             "displayTimeUnit": "ms"}
+    if args.output == "-":
+        json.dump(trace, sys.stdout)
+    else:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
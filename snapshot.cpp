@@ -0,0 +1,101 @@
+/*
+ * Snapshot of the game in play, kept in EEPROM.
+ */
+
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include <stddef.h>
+
+#include "snapshot.h"
+
+// What the EEPROM holds, byte for byte, and what it is being changed to
+static snapshot_t stored;
+static snapshot_t target;
+
+static uint8_t snapshot_crc(const snapshot_t *snap) {
+  const uint8_t *p = (const uint8_t *) snap;
+  uint8_t crc = 0;
+  for (uint8_t i = 0; i < offsetof(snapshot_t, check); i++) {
+    crc ^= p[i];
+    for (uint8_t b = 0; b < 8; b++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+bool snapshot_load(snapshot_t *snap) {
+  eeprom_read_block(&stored, (const void *) (uintptr_t) SNAPSHOT_ADDR,
+                    sizeof(stored));
+  target = stored;
+  *snap = stored;
+  return stored.magic == SNAPSHOT_MAGIC && stored.check == snapshot_crc(&stored);
+}
+
+void snapshot_save(snapshot_t *snap) {
+  snap->magic = SNAPSHOT_MAGIC;
+  snap->check = snapshot_crc(snap);
+  target = *snap;
+}
+
+void snapshot_discard() {
+  // One byte is enough; the rest is left for the next save to reuse
+  target.magic = (uint8_t) ~SNAPSHOT_MAGIC;
+}
+
+bool snapshot_flush() {
+  const uint8_t *want = (const uint8_t *) &target;
+  uint8_t *have = (uint8_t *) &stored;
+
+  // The checksum goes last: look at every other byte first
+  uint8_t i = 0;
+  while (i < offsetof(snapshot_t, check) && have[i] == want[i]) {
+    i++;
+  }
+  if (i == offsetof(snapshot_t, check) && have[i] == want[i]) {
+    return true;
+  }
+  if (eeprom_is_ready()) {
+    eeprom_write_byte((uint8_t *) (uintptr_t) (SNAPSHOT_ADDR + i), want[i]);
+    have[i] = want[i];
+  }
+  return false;
+}
+
+void snapshot_set_cell(snapshot_t *snap, uint8_t square, uint8_t value) {
+  uint8_t shift = (square & 1) ? 4 : 0;
+  uint8_t *b = &snap->cells[square >> 1];
+  *b = (*b & ~(0x0F << shift)) | ((value & 0x0F) << shift);
+}
+
+uint8_t snapshot_cell(const snapshot_t *snap, uint8_t square) {
+  uint8_t shift = (square & 1) ? 4 : 0;
+  return (snap->cells[square >> 1] >> shift) & 0x0F;
+}
+
+void snapshot_set_given(snapshot_t *snap, uint8_t square, bool given) {
+  uint8_t bit = 1 << (square & 7);
+  if (given) {
+    snap->givens[square >> 3] |= bit;
+  } else {
+    snap->givens[square >> 3] &= ~bit;
+  }
+}
+
+bool snapshot_given(const snapshot_t *snap, uint8_t square) {
+  return (snap->givens[square >> 3] >> (square & 7)) & 1;
+}
+
+void snapshot_set_elapsed(snapshot_t *snap, uint32_t seconds) {
+  for (uint8_t i = 0; i < 4; i++) {
+    snap->elapsed[i] = seconds >> (8 * i);
+  }
+}
+
+uint32_t snapshot_elapsed(const snapshot_t *snap) {
+  uint32_t seconds = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    seconds |= (uint32_t) snap->elapsed[i] << (8 * i);
+  }
+  return seconds;
+}
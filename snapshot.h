@@ -0,0 +1,60 @@
+/*
+ * Snapshot of the game in play, kept in EEPROM so that a reset carries on
+ * where the player left off without asking the server for anything.
+ *
+ * A snapshot is a few dozen bytes: the board packed two cells to a byte,
+ * a bit per cell marking the hints, the cursor and the time played.
+ * Saving one only works out which bytes differ from what the EEPROM
+ * already holds; snapshot_flush() then writes those, one byte per call and
+ * without ever waiting for the EEPROM, so it can run from a task.  Moving
+ * the cursor costs two byte writes, setting a cell two or three.
+ *
+ * The checksum is always written last, so a snapshot torn by a reset part
+ * way through a save is rejected instead of restored half old, half new.
+ */
+
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include <stdint.h>
+
+// Where the snapshot lives in EEPROM
+#define SNAPSHOT_ADDR 0
+
+// Marks a stored snapshot as holding a game
+#define SNAPSHOT_MAGIC 0x5D
+
+typedef struct {
+  uint8_t magic;        // SNAPSHOT_MAGIC, or anything else for no game
+  uint8_t cursor;       // selected cell, 0-80
+  uint8_t cells[41];    // board values, two to a byte, low nibble first
+  uint8_t givens[11];   // one bit per cell, set for the hints
+  uint8_t elapsed[4];   // seconds played, least significant byte first
+  uint8_t check;        // CRC-8 of the bytes before it
+} snapshot_t;
+
+/* Reads the snapshot in EEPROM into snap.  Must be called once at start
+ * up, before anything is saved.  Returns true if it holds a game.
+ */
+bool snapshot_load(snapshot_t *snap);
+
+/* Starts saving snap, replacing whatever save was still being written. */
+void snapshot_save(snapshot_t *snap);
+
+/* Starts marking the stored snapshot as holding no game. */
+void snapshot_discard();
+
+/* Writes the next byte of the save in progress, if the EEPROM is free.
+ * Returns true once the EEPROM holds the whole save.
+ */
+bool snapshot_flush();
+
+/* Accessors for the packed fields. */
+void snapshot_set_cell(snapshot_t *snap, uint8_t square, uint8_t value);
+uint8_t snapshot_cell(const snapshot_t *snap, uint8_t square);
+void snapshot_set_given(snapshot_t *snap, uint8_t square, bool given);
+bool snapshot_given(const snapshot_t *snap, uint8_t square);
+void snapshot_set_elapsed(snapshot_t *snap, uint32_t seconds);
+uint32_t snapshot_elapsed(const snapshot_t *snap);
+
+#endif
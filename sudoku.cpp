@@ -19,6 +19,15 @@
 #include "ArduinoExtras.h"
 #include "hashtable.h" // For hashtable
 #include "lcd_image.h" // contains lcd_image_draw, used for squares and background
+#include "glyph_tiles.h" // contains glyph_draw_cell, used for the board digits
+#include "scene.h" // retained drawing of the board cells and status fields
+#include "menu_widget.h" // table driven menus
+#include "input.h" // interrupt driven joystick, button and potentiometer events
+#include "sched.h" // cooperative scheduler running the tasks below
+#include "board_solver.h" // checks in the background that the board can be solved
+#include "snapshot.h" // keeps the game in EEPROM across resets
+#include "profile.h" // times named sections, dumped on the server's request
+#include "trace.h" // timeline of events, dumped on the server's request
 
 #include "serial_handling.h" // contains needed serial communication functions for client side
 #include "dprintf.h"  // useful debug printing
@@ -28,33 +37,21 @@
 #define TFT_CS   6 // Chip select line for TFT display.
 #define TFT_DC   7 // Data/command line for TFT display.
 #define TFT_RST  8 // Reset line for TFT (or connect to +5V).
-#define JOY_SEL  9 // Pin 9 responds to clicking the joystick.
-#define JOY_VERT_ANALOG 0 // Pin A0 responds to vertical joystick movement.
-#define JOY_HORIZ_ANALOG 1 // Pin A1 responds to horizontal joystick movement.
-#define JOY_DEADZONE 64 // Only care if position is JOY_CENTRE +/- JOY_DEADZONE.
-#define JOY_CENTRE 512 // The centre value for the joystick.
 #define TFT_WIDTH 128 // Width of the LCD.
 #define TFT_HEIGHT 160 // Height of the LCD.
 
 #define randomAnalog 7 // Analog pin used to generate random number.
-#define potentPin 2 // potentiometer pin used for difficulty
-#define selectButton 22 //for selection of numbers
-#define solveButton 23 //for solving
-#define checkButton 24 //for solving
 
 // Initialize the Adafruit LCD.
 Adafruit_ST7735 tft = Adafruit_ST7735(TFT_CS, TFT_DC, TFT_RST);
 
-// Initialize the SD card.
-Sd2Card card; // SD card reads require 512 byte buffer
+// Set once the SD card has been brought up, after the menu is showing
+bool sdReady = false;
 
 // Set the DDArduino background as the backG_image
 lcd_image_t backG_image = { "sudoku.lcd", 128, 128 }; // sudoku board
 
-// These values are used in displaying/selecting names.
-int8_t selection = 1; // The current selection.
-int8_t old_selection = 1; // The prviously selected menu option.
-int8_t update = 0; // Keeps track of vertical movement in Mode 1;
+int8_t update = 0; // Set when the board cursor moved
 
 // These values are used in changing from map mode to list mode.
 // the path request, start and stop lat and lon
@@ -62,16 +59,9 @@ int8_t update = 0; // Keeps track of vertical movement in Mode 1;
 int8_t mode = 0; // Mode 0 is the menu. Mode 1 is the game mode.
 int8_t lastmode = -1; // The previous mode.
 
-// Finite state machine controls
-//  ie. cursor and button must be released before another input is taken
-bool cursorMode = 0;   // To be used for input control
-bool lastCursorMode = 0;
-bool buttonMode = 0;
-bool lastButtonMode = 0;
-
-// maps the number between 0 and 9
-uint8_t mappedEntry = 0;
-uint8_t lastEntry = 0;
+// True while the value of the selected cell is being set with the
+// potentiometer
+bool setting = false;
 
 // corresponds to square selected on board
 uint16_t row = 0;
@@ -83,24 +73,126 @@ int8_t dif = 0;  // difficulty of game selected
 int board[9][9] = {{0}}; // Sudoku board
 HashTable doNotDisturb(30);  // HasTable to store which cells shouldn't be touched
 
-bool check = -1;  //boolean used to represent if board is correctly solved
-
-// Game main menu
-struct Menu {
-    char name[17];   //   max 17-char name
+// Background solve of the board as filled in, to tell the player when
+// they have made it unsolvable
+board_solver_t solver;
+bool boardInvalid = false;
+
+// When the result shown in modes 3 and 4 goes away, in millis(), or 0
+unsigned long resultUntil = 0;
+
+// The game as last saved to EEPROM. A save is made at most every
+// SNAPSHOT_INTERVAL ms while the board or cursor have changed, to spare
+// the EEPROM, which lasts for about 100000 writes of each byte.
+#define SNAPSHOT_INTERVAL 2000
+snapshot_t snap;
+bool snapDirty = false;  // the game changed since the last save
+bool snapSaved = false;  // the EEPROM holds (or is being sent) a game
+bool resumed = false;  // the game was restored from EEPROM at boot
+unsigned long snapLast = 0;  // millis() of the last save
+
+// When the game in play started, in millis(), counting time played
+// before a reset. Seconds played before the reset are kept in
+// gameElapsed until the game screen is entered.
+unsigned long gameStart = 0;
+uint32_t gameElapsed = 0;
+
+// A server request was started and its result is not yet acted on
+bool protoWaiting = false;
+
+// Where the recording of the raw inputs goes, if anywhere: over serial as
+// "D R" lines, or to RECORD_FILE on the SD card. Either way each line is
+// one line of a host input script.
+#define RECORD_FILE "INPUT.TXT"
+enum { RECORD_OFF, RECORD_SERIAL, RECORD_SD };
+uint8_t recording = RECORD_OFF;
+File recordFile;
+
+void clearBoard();
+void clearDND();
+void enterMode(int8_t newMode);
+void inputTask();
+void protoTask();
+void renderTask();
+void solveTask();
+void storageTask();
+void snapshotTask();
+void reportTask();
+
+// Everything after setup() runs as one of these tasks, highest priority
+// first. The storage and solve tasks run only when signalled; the protocol
+// task runs when signalled for a request, and otherwise now and then to
+// answer the server between requests.
+enum { TASK_INPUT, TASK_PROTO, TASK_RENDER, TASK_STORAGE, TASK_SOLVE,
+       TASK_SNAPSHOT, TASK_REPORT };
+task_t tasks[] = {
+    // name      function     period ms  budget us
+    { "input",   inputTask,   10,        1000 },
+    { "proto",   protoTask,   50,        2000 },
+    { "render",  renderTask,  SCENE_FRAME_MS, 8000 },
+    { "storage", storageTask, 0,         2000 },  // one long run at boot
+    { "solve",   solveTask,   0,         2000 },
+    { "snapshot", snapshotTask, 10,      1000 },
+    { "report",  reportTask,  60000,     50000 },
 };
 
-// Instruction menu option
-struct Instructions {
-    char name[26];  // max 26-char name
+// Boot phases, each stamped with micros() when it is over. Reported once
+// the SD card is up.
+// The first screen is the menu, or the game when one was resumed, in
+// which case the card is brought up before it rather than after.
+enum { BOOT_SETUP, BOOT_TFT, BOOT_INPUT, BOOT_SCREEN, BOOT_SD, BOOT_PREFETCH,
+       BOOT_PHASES };
+const char *const bootNames[BOOT_PHASES] = {
+    "setup", "tft", "input", "screen", "sd", "prefetch"
+};
+unsigned long bootTimes[BOOT_PHASES];
+uint8_t bootStamped = 0;  // bit per phase, set once it is over
+
+// Instructions, kept in flash; each line is copied out as it is printed
+#define INSTRUCT_LINES 18
+#define INSTRUCT_WIDTH 22
+const char instructions[INSTRUCT_LINES][INSTRUCT_WIDTH] PROGMEM = {
+    " HOW TO PLAY SUDOKU ",
+    "The board is made up",
+    "of a 9x9 grid with 9",
+    "3x3 boxes.",
+    " ",
+    "Each box, vertical",
+    "and horizontal line",
+    "must be filled with",
+    " numbers 1-9",
+    "Use the joystick to ",
+    "navigate the board ",
+    "And press the right ",
+    "button to access the",
+    "number selection.",
+    "Select a number with",
+    "the potentiometer and",
+    "hit the button to",
+    "resume =)",
 };
 
 
+// Layout of the main menu. Selecting item i goes to mode i-1
+const menu_item_t mainItems[] = {
+    { "SUDOKU",       10,  0, 3, 0x780F, false },
+    { "solver",       30, 24, 2, 0x0FF0, false },
+    { " START ",      45, 80, 1, 0,      true  },
+    { "Instructions", 33, 112, 1, 0,     true  },
+};
+
+// Layout of the difficulty menu. The item index is the difficulty
+const menu_item_t gameItems[] = {
+    { "Difficulty?",  0,  0, 2, 0x0FF0, false },
+    { "HARD",        50, 32, 1, 0,      true  },
+    { "MEDIUM",      45, 48, 1, 0,      true  },
+    { "EASY",        50, 64, 1, 0,      true  },
+    { "Custom",      45, 80, 1, 0,      true  },
+};
 
 // global structs
-Menu sudmenu[4];
-Instructions lines[18];
-Menu gameMenu[5];
+menu_t mainMenu = { mainItems, 4, 2 };
+menu_t gameMenu = { gameItems, 5, 1 };
 
 void displayTft(uint16_t textSize, uint16_t fg, uint16_t bg, uint16_t cursorX, uint16_t cursorY, char* text){
     /**
@@ -140,434 +232,275 @@ void displayTftVal(uint16_t textSize, uint16_t fg, uint16_t bg, uint16_t cursorX
     tft.print(val);
 }
 
-void print_names() {
+void print_instruct() {
     /**
-    Prints the names from the sudmenu struct for menu screen
+    Prints the instructions kept in flash
 
     @return Void
     */
+    char line[INSTRUCT_WIDTH];
+
     tft.fillScreen(0);
     tft.setCursor(0, 0); // where the characters will be displayed
+    tft.setTextColor(0xFFFF, 0x0000);
     tft.setTextWrap(false);
 
-    for (uint8_t i = 0; i < 4; i++) {
-        if (i != selection) { // Not highlighted
-            tft.setTextColor(0xFFFF, 0x0000);
-        } else { // Highlighted
-            tft.setTextColor(0x0000, 0xFFFF);
-        }
+    for (uint8_t i = 0; i < INSTRUCT_LINES; i++) {
+        strcpy_P(line, instructions[i]);
+        tft.print(line);
+        tft.print("\n");
+    }
+}
 
-        // Hard coded positions for menu options
-        switch (i) {
-            case 0:
-            tft.setCursor(10, 0);
-            tft.setTextSize(3);
-            tft.setTextColor(0x780F, 0x0000);
-            break;
+void scanJoystick() {
+    /**
+    Takes queued joystick events. Used in navigating the menu
 
-            case 1:
-            tft.setCursor(30, i*16+8);
-            tft.setTextSize(2);
-            tft.setTextColor(0x0FF0, 0x0000);
+    @return Void
+    */
+    input_event_t ev;
+    while (mode == 0 && input_poll(&ev)) {
+        switch (ev.type) {
+            case INPUT_CLICK:  // If button is presed, change mode
+            enterMode(mainMenu.selection-1);
             break;
 
-            case 2:
-            tft.setCursor(45, i*32+16);
-            tft.setTextSize(1);
+            case INPUT_UP:
+            menu_move(&tft, &mainMenu, -1);
             break;
 
-            case 3:
-            tft.setCursor(33, i*32+16);
-            tft.setTextSize(1);
+            case INPUT_DOWN:
+            menu_move(&tft, &mainMenu, 1);
             break;
         }
-        tft.print(sudmenu[i].name);
-        tft.print("\n");
     }
-    tft.print("\n");
-    update = 0;
 }
 
-void update_names() {
+
+void scanDifficulty() {
     /**
-    Used in updating of cursor selection on main menu
+    Takes queued joystick events. Used in selecting a difficulty
 
     @return Void
     */
-    switch (selection) {
-
-        case 2: // START
-        tft.setTextColor(ST7735_WHITE, ST7735_BLACK);
-
-        if (old_selection == 3) {
-            tft.setCursor(33, old_selection*32+16);
+    input_event_t ev;
+    while (mode == 1 && input_poll(&ev)) {
+        if (dif != 0) {
+            continue;  // drop presses made while the board is generated
         }
+        switch (ev.type) {
+            case INPUT_CLICK:  // If button is presed, use chosen difficulty
+            dif = gameMenu.selection;
+            if (dif == 4) {  //custom board mode lets you input your own board
+                dif = 0;
+                enterMode(5);
+            }
+            else {
+                // runs the board generating routine; mode 5 starts once the
+                // board has arrived
+                proto_generate(dif, board);
+                protoWaiting = true;
+                sched_signal(TASK_PROTO);
+            }
+            break;
 
-        tft.print(sudmenu[old_selection].name);
-
-        delay(100);
-
-        // Highlight new selection
-        tft.setTextColor(ST7735_BLACK, ST7735_WHITE);
-        tft.setCursor(45, selection*32+16);
-        tft.print(sudmenu[selection].name);
+            case INPUT_UP:
+            menu_move(&tft, &gameMenu, -1);
+            break;
 
-        update = 0; // Resets the update variable
-        break;
+            case INPUT_DOWN:
+            menu_move(&tft, &gameMenu, 1);
+            break;
+        }
+    }
+}
 
-        case 3: // Instructions
+bool clicked() {
+    /**
+    Takes queued input events, looking for a joystick click. Used on screens
+        that only wait to go back to the menu
 
-        tft.setTextColor(ST7735_WHITE, ST7735_BLACK);
-        if (old_selection == 2) {
-            tft.setCursor(45, old_selection*32+16);
+    @return true if the joystick was clicked
+    */
+    input_event_t ev;
+    while (input_poll(&ev)) {
+        if (ev.type == INPUT_CLICK) {
+            return true;
         }
+    }
+    return false;
+}
 
+void moveCursor(int8_t delta) {
+    /**
+    Moves the board cursor, wrapping around the edges of the board
 
-        tft.print(sudmenu[old_selection].name);
-
-        delay(100);
+    @param delta  cells to move by (+-1 for left/right, +-9 for up/down)
 
-        // Highlight new selection
-        tft.setTextColor(ST7735_BLACK, ST7735_WHITE);
-        tft.setCursor(33, selection*32+16);
-        tft.print(sudmenu[selection].name);
-        update = 0; // Resets the update variable
-        break;
+    @return Void
+    */
+    boardSquare += delta;
+    if (boardSquare < 0) {
+        boardSquare += 81;  // if off the top/start, come back at the end
+    }
+    else if (boardSquare > 80) {
+        boardSquare -= 81;  // if off the bottom/end, come back at the start
     }
+    update = 1;
+    snapDirty = true;
 }
 
-void print_instruct() {
+void startSolve() {
     /**
-    Prints data off of instruction struct
+    (Re)starts the background solve of the board as it is now. The solve
+        task works through it a slice at a time
 
     @return Void
     */
-    tft.fillScreen(0);
-    tft.setCursor(0, 0); // where the characters will be displayed
-    tft.setTextColor(0xFFFF, 0x0000);
-    tft.setTextWrap(false);
-
-    for (uint8_t i = 0; i < 18; i++) {
-        tft.print(lines[i].name);
-        tft.print("\n");
+    uint8_t cells[81];
+    for (uint8_t i = 0; i < 81; i++) {
+        cells[i] = board[i / 9][i % 9];
     }
+    board_solver_begin(&solver, cells);
+    sched_signal(TASK_SOLVE);
 }
 
-void scanJoystick() {
+void setSquare(uint8_t value) {
     /**
-    Scans joystick fornew inputs. Used in navigating the menu
+    Sets the value of the selected cell
+
+    @param value  the new value, 1-9
 
     @return Void
     */
-
-    // Get the vertical/horizontal/clicked state of the joystick.
-    int vert = analogRead(JOY_VERT_ANALOG);
-    int horiz = analogRead(JOY_HORIZ_ANALOG);
-    int select = digitalRead(JOY_SEL);
-
-    // If button is presed, change mode
-    if (select == 0) {
-        lastmode = mode;
-        mode = selection-1;
-    }
-    // checks if joystick is up or down
-    if (mode == 0){
-        if (abs(vert - JOY_CENTRE) > JOY_DEADZONE) {
-            // If the joystick is up, the reading is smaller
-            if (vert - JOY_CENTRE < 0) {
-                // Subtract from selection variable.
-                update = -1;
-            }
-            else {
-                // Add to selection variable.
-                update = 1;
-            }
-        }
-    }
+    board[row][col] = value;
+    scene_mark_peers(row*9 + col);  // conflicts may have come or gone
+    startSolve();
+    snapDirty = true;
 }
 
-
-void print_options() {
+void boardInp() {
     /**
-    Print off the difficulty options menu
+    Takes queued input events in game
 
     @return Void
     */
+    PROFILE_SECTION("boardInp");
+    input_event_t ev;
+    while (mode == 5 && input_poll(&ev)) {
+        switch (ev.type) {
+            // moving the cursor; not while a value is being set
+            case INPUT_UP:
+            if (!setting) moveCursor(-9);
+            break;
 
-    tft.fillScreen(0);
-    tft.setCursor(0, 0); // where the characters will be displayed
+            case INPUT_DOWN:
+            if (!setting) moveCursor(9);
+            break;
 
-    for (uint8_t i = 0; i < 5; i++) {
-        if (i != selection) { // Not highlighted
-            tft.setTextColor(0xFFFF, 0x0000);
-        } else { // Highlighted
-            tft.setTextColor(0x0000, 0xFFFF);
-        }
+            case INPUT_LEFT:
+            if (!setting) moveCursor(-1);
+            break;
 
-        // Hard coded positions for menu options
-        switch (i) {
-            case 0:  // Difficulty title
-            tft.setCursor(0, 0);
-            tft.setTextSize(2);
-            tft.setTextColor(0x0FF0, 0x0000);
+            case INPUT_RIGHT:
+            if (!setting) moveCursor(1);
             break;
 
-            case 1:  // Hard
-            tft.setCursor(50, i*16+16);
-            tft.setTextSize(1);
+            case INPUT_SELECT:
+            // select toggles setting mode, except on hint cells
+            if (setting) {
+                setting = false;
+            }
+            else if (!doNotDisturb.exists(row*9 + col)) {
+                setting = true;
+                setSquare(input_pot_digit());
+            }
             break;
 
-            case 2:  // Medium
-            tft.setCursor(45, i*16+16);
-            tft.setTextSize(1);
+            case INPUT_POT:
+            if (setting) {
+                setSquare(ev.value);
+            }
             break;
 
-            case 3:  // Easy
-            tft.setCursor(50, i*16+16);
-            tft.setTextSize(1);
+            case INPUT_CLICK:  // if click, go back to menu
+            clearBoard();  // reset board state
+            clearDND();
+            setting = false;
+            enterMode(0);
             break;
 
-            case 4:  // Custom board - input your own board
-            tft.setCursor(45, i*16+16);
-            tft.setTextSize(1);
+            case INPUT_CHECK:  // go to board check routine
+            setting = false;
+            enterMode(3);
             break;
 
+            case INPUT_SOLVE:  // go to solve check routine
+            setting = false;
+            enterMode(4);
+            break;
         }
-        delay(100);
-        tft.print(gameMenu[i].name);
-        tft.print("\n");
     }
-    tft.print("\n");
-    update = 0;
 }
 
-
-void update_options() {
+bool cell_conflicts(uint8_t r, uint8_t c) {
     /**
-    Used in updating of cursor selection on game menu
-
-    @return Void
-    */
-
-    switch (selection) {
-        case 1: // Hard
-        tft.setTextColor(ST7735_WHITE, ST7735_BLACK);
-
-        if (old_selection == 4) {
-            tft.setCursor(45, old_selection*16+16);
-        }
-        else if (old_selection == 2) {
-            tft.setCursor(45, old_selection*16+16);
-        }
-
-        tft.print(gameMenu[old_selection].name);
-
-        delay(500);
-
-        // Highlight new selection
-        tft.setTextColor(ST7735_BLACK, ST7735_WHITE);
-        tft.setCursor(50, selection*16+16);
-        tft.print(gameMenu[selection].name);
-
-        update = 0; // Resets the update variable
-        break;
-
-        case 2: // Medium
-        tft.setTextColor(ST7735_WHITE, ST7735_BLACK);
-
-        if (old_selection == 3) {
-            tft.setCursor(50, old_selection*16+16);
-        }
-        else if (old_selection == 1) {
-            tft.setCursor(50, old_selection*16+16);
-        }
-
-        tft.print(gameMenu[old_selection].name);
-
-        delay(500);
+    Checks whether the value in a cell is repeated elsewhere in its row,
+        column or 3x3 box
 
-        // Highlight new selection
-        tft.setTextColor(ST7735_BLACK, ST7735_WHITE);
-        tft.setCursor(45, selection*16+16);
-        tft.print(gameMenu[selection].name);
+    @param r  row of the cell
+    @param c  column of the cell
 
-        update = 0; // Resets the update variable
-        break;
-
-        case 3: // Easy
-
-        tft.setTextColor(ST7735_WHITE, ST7735_BLACK);
-        if (old_selection == 2) {
-            tft.setCursor(45, old_selection*16+16);
-        }
-        else if (old_selection == 4) {
-            tft.setCursor(45, old_selection*16+16);
+    @return true if another cell in the same row, column or box holds the
+        same (non zero) value
+    */
+    int val = board[r][c];
+    if (val == 0) {
+        return false;
+    }
+    uint8_t br = r - r % 3;
+    uint8_t bc = c - c % 3;
+    for (uint8_t i = 0; i < 9; i++) {
+        if (i != c && board[r][i] == val) {
+            return true;
         }
-        tft.print(gameMenu[old_selection].name);
-
-        delay(500);
-
-        // Highlight new selection
-        tft.setTextColor(ST7735_BLACK, ST7735_WHITE);
-        tft.setCursor(50, selection*16+16);
-        tft.print(gameMenu[selection].name);
-        update = 0; // Resets the update variable
-        break;
-
-        case 4: // Custom
-
-        tft.setTextColor(ST7735_WHITE, ST7735_BLACK);
-        if (old_selection == 1) {
-            tft.setCursor(50, old_selection*16+16);
+        if (i != r && board[i][c] == val) {
+            return true;
         }
-        else if (old_selection == 3) {
-            tft.setCursor(50, old_selection*16+16);
+        uint8_t rr = br + i / 3;
+        uint8_t cc = bc + i % 3;
+        if ((rr != r || cc != c) && board[rr][cc] == val) {
+            return true;
         }
-        tft.print(gameMenu[old_selection].name);
-
-        delay(500);
-
-        // Highlight new selection
-        tft.setTextColor(ST7735_BLACK, ST7735_WHITE);
-        tft.setCursor(45, selection*16+16);
-        tft.print(gameMenu[selection].name);
-        update = 0; // Resets the update variable
-        break;
     }
+    return false;
 }
 
-
-void scanDifficulty() {
+uint8_t cell_look(uint8_t square) {
     /**
-    Scans joystick fornew inputs. Used in selecting a difficulty
-
-    @return Void
-    */
+    Works out how a board cell should be drawn. Used by the scene when
+        repainting dirty cells
 
-    // Get the vertical/horizontal/clicked state of the joystick.
-    int vert = analogRead(JOY_VERT_ANALOG);
-    int horiz = analogRead(JOY_HORIZ_ANALOG);
-    int select = digitalRead(JOY_SEL);
+    @param square  the cell on the board, 0-80
 
-    // If button is presed, change mode
-    if (select == 0) {
-        dif = selection;  // return chosen difficulty
-    }
-    // checks if joystick is up or down
-    if (mode == 1){
-        if (abs(vert - JOY_CENTRE) > JOY_DEADZONE) {
-            // If the joystick is up, the reading is smaller
-            if (vert - JOY_CENTRE < 0) {
-                // Subtract from selection variable.
-                update = -1;
-            }
-            else {
-                // Add to selection variable.
-                update = 1;
-            }
-        }
-    }
-}
-
-void boardInp() {
-    /**
-    Takes input from joystick in game
-
-    @return Void
+    @return the cell's digit and tile style packed with SCENE_LOOK
     */
-
-    // Get the vertical/horizontal/clicked state of the joystick.
-    int vert = analogRead(JOY_VERT_ANALOG);
-    int horiz = analogRead(JOY_HORIZ_ANALOG);
-    int select = digitalRead(JOY_SEL);
-
-    // if direction is detected, stateMachine state is turned on.
-    // Determines whether joystick input is up or down
-    if (abs(vert - JOY_CENTRE) > JOY_DEADZONE) {
-        // If the joystick is up, the reading is smaller
-        if (vert - JOY_CENTRE < 0) {
-            // Subtract from selection variable.
-            lastCursorMode = cursorMode;
-            if (lastCursorMode == 0) {
-                cursorMode = 1;
-                boardSquare -= 9;  // go down a col
-                update = 1;
-                if (boardSquare < 0) {
-                    boardSquare += 81;  // if at the bottom of the scree, go to the top
-                }
-            }
-        } else {
-            // Add to selection variable.
-            lastCursorMode = cursorMode;
-            if (lastCursorMode == 0) {
-                cursorMode = 1;
-                boardSquare += 9;  // go up a col
-                update = 1;
-                if (boardSquare > 80) {
-                    boardSquare -= 81; // if at the bottom of the screen, go to the top
-                }
-            }
-        }
+    uint8_t r = square / 9;
+    uint8_t c = square % 9;
+    glyph_style_t style;
+    if (cell_conflicts(r, c)) {
+        style = GLYPH_CONFLICT;
     }
-    // determines whether joystick input is left or right
-
-    else if (abs(horiz - JOY_CENTRE) > JOY_DEADZONE) {
-        // If the joystick is left, the reading is smaller
-        if (horiz - JOY_CENTRE < 0) {
-            // Subtract from selection variable.
-            lastCursorMode = cursorMode;
-            if (lastCursorMode == 0) {
-                cursorMode = 1;
-                boardSquare -= 1; // go left in a row
-                update = 1;
-                if (boardSquare < 0) {
-                    boardSquare += 81; // if at 0, go to 81
-                }
-            }
-        } else {
-            // Add to selection variable.
-            lastCursorMode = cursorMode;
-            if (lastCursorMode == 0) {
-                cursorMode = 1;
-                boardSquare += 1;  // go right in a row
-                update = 1;
-                if (boardSquare > 80) {
-                    boardSquare -= 81;  // if at 81, go to 0
-                }
-            }
-        }
+    else if (square == boardSquare) {
+        style = GLYPH_SELECTED;
     }
-
-    else if ((digitalRead(selectButton) == LOW)) {
-        lastButtonMode = buttonMode;
-        // allow changes to number on board if button has been pressed and released
-        //  and coordinates are not in doNotDisturb table (don't remove hints)
-        if (!lastButtonMode && !doNotDisturb.exists(row*9 + col)){
-            displayTft(1, 0xF800, ST7735_BLACK, 75, 130, "SETTING:");
-            int entry;
-            entry = analogRead(potentPin);
-            lastEntry = map(entry, 0, 1023, 0, 9);
-            while(digitalRead(selectButton) == LOW) {}
-            while(digitalRead(selectButton) == HIGH) {
-                buttonMode = 1;
-                entry = analogRead(potentPin);
-                mappedEntry = map(entry, 0, 1023, 1, 10);
-                if (mappedEntry != lastEntry){  // if number has changed, display change
-                    if (mappedEntry < 10){
-                        displayTftVal(1, ST7735_RED, ST7735_WHITE, col*14+5, row*14+5, mappedEntry);
-                        update = 1;
-                        lastEntry = mappedEntry;
-                        board[row][col] = mappedEntry;
-                    }
-                }
-            }
-        }
+    else if (doNotDisturb.exists(square)) {
+        style = GLYPH_GIVEN;
     }
-
-    else {  // reset finite state vars if nothing is happening
-        cursorMode = 0;
-        buttonMode = 0;
+    else {
+        style = GLYPH_USER;
     }
+    return SCENE_LOOK(board[r][c], style);
 }
 
 void update_square() {
@@ -581,41 +514,32 @@ void update_square() {
     row = boardSquare / 9;
     col = boardSquare % 9;
 
-    // Highlight new selection
-    tft.setTextSize(1);
-    if (doNotDisturb.exists(row*9 + col)) {
-        tft.setTextColor(ST7735_BLACK, ST7735_WHITE);
-    }
-    else {
-        tft.setTextColor(ST7735_RED, ST7735_WHITE);
-
+    // Restore the cell the cursor moved off of
+    if (lastSquare != boardSquare) {
+        scene_mark(lastSquare);
+        lastSquare = boardSquare;
     }
-    if (board[row][col] != NULL){
-        tft.setCursor(col*14+5, row*14+5);
-        tft.print(board[row][col]);
 
-    }
+    // Highlight new selection
+    scene_mark(boardSquare);
 
-    delay(100);
     update = 0; // Resets the update variable
 }
 
 void display_board() {
     /**
-    displays the current inputted values on the board
+    displays the current inputted values on the board. Cells that already
+        show their value are left alone
 
     Complexity: O(|V|)
         Where V is the number of verticies in the graph
 
     @return Void
     */
-    for (uint8_t i=0; i<9; i++) {
-        for (uint8_t j=0; j<9; j++){
-            if (board[i][j] != NULL){
-                displayTftVal(1, ST7735_BLACK, ST7735_WHITE, j*14+5, i*14+5, board[i][j]);
-            }
-        }
-    }
+    PROFILE_SECTION("display_board");
+    TRACE_SCOPE("display_board");
+    scene_mark_all();
+    scene_flush(true);
 }
 
 void clearBoard() {
@@ -625,6 +549,11 @@ void clearBoard() {
     memset(board, 0, sizeof(board[0][0]) * 9 * 9);
 }
 
+// Values stored for the hints in doNotDisturb
+const char *const digitNames[10] = {
+    "0", "1", "2", "3", "4", "5", "6", "7", "8", "9"
+};
+
 void setDND(int board[9][9]) {
     /**
     Adds the hints to a HashTable to reference when checking to see if users
@@ -640,10 +569,8 @@ void setDND(int board[9][9]) {
 
     for (uint8_t i=0; i<9; i++) {
         for (uint8_t j=0; j<9; j++){
-            if (board[i][j] != NULL){
-                char* c;
-                sprintf(c, "%d", board[i][j]);
-                doNotDisturb.set(i*9 + j, c);
+            if (board[i][j] != 0){
+                doNotDisturb.set(i*9 + j, digitNames[board[i][j]]);
             }
         }
     }
@@ -697,257 +624,514 @@ void debugMode() {
     }
 }
 
+void saveGame() {
+    /**
+    Starts saving the game in play to EEPROM; the snapshot task writes it
+        out a byte at a time
+
+    @return Void
+    */
+    for (uint8_t i = 0; i < 81; i++) {
+        snapshot_set_cell(&snap, i, board[i / 9][i % 9]);
+        snapshot_set_given(&snap, i, doNotDisturb.exists(i));
+    }
+    snap.cursor = boardSquare;
+    snapshot_set_elapsed(&snap, (millis() - gameStart) / 1000);
+    snapshot_save(&snap);
+    snapSaved = true;
+}
+
+bool restoreGame() {
+    /**
+    Puts back the game saved in EEPROM, if there is one: the board, the
+        hints, the cursor and the time played
+
+    @return true if a game was restored
+    */
+    if (!snapshot_load(&snap)) {
+        return false;
+    }
+    for (uint8_t i = 0; i < 81; i++) {
+        uint8_t value = snapshot_cell(&snap, i);
+        board[i / 9][i % 9] = value <= 9 ? value : 0;
+        if (snapshot_given(&snap, i)) {
+            doNotDisturb.set(i, digitNames[board[i / 9][i % 9]]);
+        }
+    }
+    boardSquare = lastSquare = snap.cursor <= 80 ? snap.cursor : 0;
+    row = boardSquare / 9;
+    col = boardSquare % 9;
+    gameElapsed = snapshot_elapsed(&snap);
+    snapSaved = true;
+    return true;
+}
+
+void bootMark(uint8_t phase) {
+    /**
+    Records that a boot phase is over
+
+    @param phase  the BOOT_ phase that just finished
+
+    @return Void
+    */
+    bootTimes[phase] = micros();
+    bootStamped |= 1 << phase;
+}
+
+void bootReport() {
+    /**
+    Prints when each boot phase finished, and how long it took, in the
+        order they finished. Phases that never finished (the SD card ones,
+        when the card did not come up) are left out
+
+    @return Void
+    */
+    unsigned long last = 0;
+    uint8_t printed = ~bootStamped;  // bit per phase
+    while (printed != 0xFF) {
+        uint8_t next = 0xFF;
+        for (uint8_t i = 0; i < BOOT_PHASES; i++) {
+            if (!(printed & (1 << i)) &&
+                (next == 0xFF || bootTimes[i] < bootTimes[next])) {
+                next = i;
+            }
+        }
+        printed |= 1 << next;
+        dprintf("boot %s: %lu us (+%lu)", bootNames[next],
+            bootTimes[next], bootTimes[next] - last);
+        last = bootTimes[next];
+    }
+}
+
+bool storageBegin() {
+    /**
+    Brings up the SD card, if that has not happened yet, and opens the
+        board background so the first game starts drawing straight away
+
+    @return true if the card can be used
+    */
+    if (sdReady) {
+        return true;
+    }
+    dprintf("Initializing SD card...");
+    if (!SD.begin(SD_CS)) {
+        dprintf("failed!");
+        return false;
+    }
+    dprintf("OK!");
+
+    // The card has to be initialized on a slow clock, but after that it
+    // and the display both work at the full 8 MHz
+    SPI.setClockDivider(SPI_CLOCK_DIV2);
+    sdReady = true;
+    bootMark(BOOT_SD);
+
+    lcd_image_open(&backG_image);
+    bootMark(BOOT_PREFETCH);
+    return true;
+}
+
+void recordLine(const char *line) {
+    /**
+    Writes a line of the recording where the recording goes
+
+    @param line  the line, without its newline
+
+    @return Void
+    */
+    if (recording == RECORD_SD) {
+        recordFile.println(line);
+    }
+    else {
+        dprintf("R %s", line);
+    }
+}
+
+void recordInput() {
+    /**
+    Sends the raw input changes recorded since the last call where the
+        recording goes
+
+    @return Void
+    */
+    input_change_t c;
+    while (input_record_poll(&c)) {
+        char line[24];
+        if (c.pin >= A0) {
+            snprintf(line, sizeof(line), "%lu A%u %u", (unsigned long) c.ms,
+                (unsigned) (c.pin - A0), c.value);
+        }
+        else {
+            snprintf(line, sizeof(line), "%lu %u %u", (unsigned long) c.ms,
+                (unsigned) c.pin, c.value);
+        }
+        recordLine(line);
+    }
+}
+
+void recordReceived(const char *line) {
+    /**
+    Records a line received from the server along with the inputs, so a
+        replay without a server gets the same answers at the same times
+
+    @param line  the line received
+
+    @return Void
+    */
+    if (recording == RECORD_OFF || line[0] == 'R' || line[0] == 'W') {
+        return;  // starting and stopping the recording is not replayed
+    }
+    recordInput();  // the inputs before it go first, keeping the times in order
+    char text[56];
+    snprintf(text, sizeof(text), "%lu serial %s", millis(), line);
+    recordLine(text);
+}
+
+void stopRecording() {
+    /**
+    Stops recording the inputs, ending the recording with a line that stops
+        the run when it is replayed
+
+    @return Void
+    */
+    input_record(false);
+    recordInput();
+    char line[16];
+    snprintf(line, sizeof(line), "%lu end", millis());
+    recordLine(line);
+    if (recording == RECORD_SD) {
+        recordFile.close();
+    }
+    recording = RECORD_OFF;
+}
+
+void serverCommand(const char *line) {
+    /**
+    Acts on a line from the server that is not part of a request: 'R'
+        starts or stops recording the inputs over serial, 'W' to the SD card.
+        A recording only starts after a reset, before any input, with no
+        game resumed
+
+    @param line  the line received
+
+    @return Void
+    */
+    if (line[0] != 'R' && line[0] != 'W') {
+        return;
+    }
+    if (recording != RECORD_OFF) {
+        stopRecording();
+        return;
+    }
+    // A replay starts at reset, in the menu, with the EEPROM erased, so a
+    // recording has to start from there too
+    if (resumed || !input_untouched()) {
+        dprintf("Recording starts only after a reset, with no game saved");
+        return;
+    }
+    if (line[0] == 'W') {
+        if (!storageBegin()) {
+            return;
+        }
+        SD.remove(RECORD_FILE);  // a recording starts from scratch
+        recordFile = SD.open(RECORD_FILE, FILE_WRITE);
+        if (!recordFile) {
+            dprintf("Cannot write " RECORD_FILE);
+            return;
+        }
+        recording = RECORD_SD;
+    }
+    else {
+        recording = RECORD_SERIAL;
+    }
+    input_record(true);
+}
+
 void setup() {
+    /**
+    Brings up only what the menu needs; the SD card is left to the storage
+        task, once the menu is showing
+
+    @return Void
+    */
     init();
     Serial.begin(9600);
     Serial.flush();    // There can be nasty leftover bits.
+    profile_begin();
+    bootMark(BOOT_SETUP);
 
     // This seems to fix some SD card readblock errors.
     tft.initR(INITR_BLACKTAB);
     tft.fillScreen(ST7735_BLACK);
+    glyph_init(TFT_CS, TFT_DC);
+    scene_init(&tft, cell_look);
+    bootMark(BOOT_TFT);
+
+    // Initialize the joystick, buttons and potentiometer sampling
+    input_begin();
+    bootMark(BOOT_INPUT);
+    proto_on_command(serverCommand);
+    proto_on_receive(recordReceived);
+
+    // Carry on with the game that was being played before the reset
+    resumed = restoreGame();
+}
 
-    dprintf("Initializing SPI communication for raw reads...");
-    if (!card.init(SPI_HALF_SPEED, SD_CS)) {
-        dprintf("failed!");
-        while (true) {}
-    } else {
-        dprintf("OK!");
+void enterMode(int8_t newMode) {
+    /**
+    Switches mode, drawing the new mode's screen and starting any server
+        request it needs
+
+    @param newMode  the mode to go to
+
+    @return Void
+    */
+    lastmode = mode;
+    mode = newMode;
+    resultUntil = 0;
+    debugMode();
+
+    switch (mode) {
+        case 0:  // menu mode
+        menu_show(&tft, &mainMenu, NULL);
+        break;
+
+        case 1:  // pre game
+        menu_show(&tft, &gameMenu, &mainMenu);
+        dif = 0;
+        break;
+
+        case 2:  // instruction mode
+        print_instruct();
+        break;
+
+        case 3:  // board check mode
+        proto_check(board);  // run server client check routine
+        protoWaiting = true;
+        sched_signal(TASK_PROTO);
+        break;
+
+        case 4:  // board solve mode
+        proto_solve(board);  // run board solving algorithm
+        protoWaiting = true;
+        sched_signal(TASK_PROTO);
+        break;
+
+        case 5:  // game mode
+        storageBegin();  // in case the game starts before the card is up
+        lcd_image_draw(&backG_image, &tft, 0, 0, 0, 0,
+            backG_image.ncols, backG_image.nrows);
+        scene_invalidate();  // background covered whatever was drawn before
+        // Displays small game graphic at bottom of tft
+        displayTft(2, ST7735_RED, ST7735_BLACK, 0, 130, "Super");
+        displayTft(2, ST7735_GREEN, ST7735_BLACK, 0, 145, "SOLVER");
+        boardInvalid = false;
+        startSolve();
+        gameStart = millis() - gameElapsed * 1000UL;
+        gameElapsed = 0;
+        update = 1;  // show the cursor
+        snapDirty = true;
+        break;
     }
+}
 
-    dprintf("Initializing SD card...");
-    if (!SD.begin(SD_CS)) {
-        dprintf("failed!");
-        return;
+void inputTask() {
+    /**
+    Task taking the queued input events for the current mode, and ending
+        timed result screens
+
+    @return Void
+    */
+    if (recording != RECORD_OFF) {
+        recordInput();
     }
-    dprintf("OK!");
 
-    // Initialize the joystick button.
-    pinMode(JOY_SEL, INPUT);
-    digitalWrite(JOY_SEL, HIGH);
-
-    // Initialize buttons
-    pinMode(selectButton, INPUT);
-    pinMode(solveButton, INPUT);
-    pinMode(checkButton, INPUT);
-    digitalWrite(selectButton, HIGH);
-    digitalWrite(solveButton, HIGH);
-    digitalWrite(checkButton, HIGH);
-
-    // Hard coding Menu
-    strcpy(sudmenu[0].name, "SUDOKU");
-    strcpy(sudmenu[1].name, "solver");
-    strcpy(sudmenu[2].name, " START ");
-    strcpy(sudmenu[3].name, "Instructions");
-
-    // Hard coding Difficulty menu
-    strcpy(gameMenu[0].name, "Difficulty?");
-    strcpy(gameMenu[1].name, "HARD");
-    strcpy(gameMenu[2].name, "MEDIUM");
-    strcpy(gameMenu[3].name, "EASY");
-    strcpy(gameMenu[4].name, "Custom");
-
-
-    // Hard coding Instructions
-    strcpy(lines[0].name, " HOW TO PLAY SUDOKU ");
-    strcpy(lines[1].name, "The board is made up");
-    strcpy(lines[2].name, "of a 9x9 grid with 9");
-    strcpy(lines[3].name, "3x3 boxes.");
-    strcpy(lines[4].name, " ");
-    strcpy(lines[5].name, "Each box, vertical");
-    strcpy(lines[6].name, "and horizontal line");
-    strcpy(lines[7].name, "must be filled with");
-    strcpy(lines[8].name, " numbers 1-9");
-    strcpy(lines[9].name, "Use the joystick to ");
-    strcpy(lines[10].name, "navigate the board ");
-    strcpy(lines[11].name, "And press the right ");
-    strcpy(lines[12].name, "button to access the");
-    strcpy(lines[13].name, "number selection.");
-    strcpy(lines[14].name, "Select a number with");
-    strcpy(lines[15].name, "the potentiometer and");
-    strcpy(lines[16].name, "hit the button to");
-    strcpy(lines[17].name, "resume =)");
+    switch (mode) {
+        case 0:
+        scanJoystick();
+        break;
+
+        case 1:
+        scanDifficulty();
+        break;
+
+        case 2:
+        case 4:
+        // prints the instrucitons or the solved board and waits for joystick
+        // input; while a request is running presses are dropped
+        if (clicked() && proto_status() != PROTO_BUSY && resultUntil == 0) {
+            clearBoard();  // reset board for next game
+            clearDND();  // reset hint dict
+            enterMode(0);
+        }
+        break;
+
+        case 3:
+        input_flush();  // drop presses made while waiting
+        break;
+
+        case 5:
+        boardInp();
+        break;
+    }
+
+    if (resultUntil != 0 && (long) (millis() - resultUntil) >= 0) {
+        clearBoard();  // reset the board for the next game
+        clearDND();
+        enterMode(0);
+    }
 }
 
-int main() {
-    setup();
-    uint8_t select = 1; // intializes variable that stores click state
-    while (true) {
+void protoTask() {
+    /**
+    Task moving the current server request along, and acting on its
+        result once it is finished
 
-        select = digitalRead(JOY_SEL);
+    @return Void
+    */
+    proto_status_t status = proto_pump();
+    if (status == PROTO_BUSY) {
+        sched_signal(TASK_PROTO);  // run again next pass
+        return;
+    }
+    if (!protoWaiting) {
+        return;  // result already acted on
+    }
+    protoWaiting = false;
 
-        // Mode 0 is menu mode.
-        while (mode == 0) {
-            // if changing into menu mode, print the menu options
-            if (lastmode != mode) {
-                debugMode();
-                print_names();
-                lastmode = mode;
-            }
+    switch (mode) {
+        case 1:  // board generated
+        if (status == PROTO_DONE) {
+            setDND(board);  // Sets Do Not Disturb cells, ie. hint cells
+            enterMode(5);
+        }
+        else {
+            dprintf("Error in Generation");
+            clearBoard();
+            dif = 0;
+        }
+        break;
 
-            // Scans for joystick input
-            scanJoystick();
-
-            // selection and old_selection are used for highlighting
-            // in list mode.
-            old_selection = selection;
-            selection = selection + update;
-            if (selection == 1) {
-                selection = 3;
-            } else if (selection == 4) {
-                selection = 2;
-            }
-            if (update != 0) {
-                update_names();
-            }
-            //delay(100);
+        case 3:  // board checked
+        dprintf("result: %d", proto_result());
+        if (status != PROTO_DONE) {
+            dprintf("Error occured in check");
         }
-        // Game mode
-        if (mode == 5) {
-            lcd_image_draw(&backG_image, &tft, 0, 0, 0, 0, TFT_WIDTH, TFT_HEIGHT);
-            display_board();
-            // Displays small game graphic at bottom of tft
-            displayTft(2, ST7735_RED, ST7735_BLACK, 0, 130, "Super");
-            displayTft(2, ST7735_GREEN, ST7735_BLACK, 0, 145, "SOLVER");
-
-            tft.setCursor(1,1);  // resets cursor for game start
-            while(mode == 5) {
-                select = digitalRead(JOY_SEL);
-                if (select == 0) {
-                    // if click, go back to menu
-                    clearBoard();  // reset board state
-                    clearDND();
-                    lastmode = mode;
-                    mode = 0;
-                    delay(800);
-                }
-                boardInp();
-
-                // Displays current selection position
-                displayTft(1, 0xFFE0, ST7735_BLACK, 75, 130, "Current:");
-                tft.setCursor(95, 140);
-                tft.print(row);tft.print(" ");tft.print(col);
-                // Serial.print(col*14+3); Serial.print(" "); Serial.println(row*14+3);
-
-                if (update != 0) {  // updates the selection location
-                    tft.setCursor(col*14+5, row*14+5);
-                    update_square();
-                }
-                // If checkButton is pressd, go to board check routine
-                if (digitalRead(checkButton) == LOW) {
-                    dprintf("Should go to mode 3");
-
-                    lastmode = mode;
-                    mode = 3;
-                    delay(500);
-                }
-                // If SolveButton is pressed, go to solve check routine
-                else if (digitalRead(solveButton) == LOW){
-                    dprintf("go to mode 4");
-                    lastmode = mode;
-                    mode = 4;
-                    delay(500);
-                }
-            }
+        else if (proto_result() == 1) {
+            displayTft(2, 0xF000, ST7735_WHITE, 25, 60, "CORRECT");
         }
-        if (mode == 2) { // instruciton mode
-            print_instruct();
-            // prints the instrucitons and waits for joystick input
-            while(mode == 2) {
-                select = digitalRead(JOY_SEL);
-                if (select == 0) {
-                    // if click, go back to menu
-                    mode = 0; lastmode = 2;
-                    delay(800);
-                }
-            }
+        else {
+            displayTft(2, 0xF800, ST7735_WHITE, 15, 60, "INCORRECT");
         }
-        if (mode == 3) {  // board check mode
-            dprintf("mode 3");
-            check = check_board(board);  // run server client check routine
-            dprintf("result: %d",check);
-            if (check == -1) {
-                dprintf("Error occured in check");
-                lastmode = mode;
-                mode = 0;
-            }
-            if (check) {
-                displayTft(2, 0xF000, ST7735_WHITE, 25, 60, "CORRECT");
-            }
-            else{
-                displayTft(2, 0xF800, ST7735_WHITE, 15, 60, "INCORRECT");
-            }
-            delay(3000);
-            clearBoard();  // reset the board for the next game
-            clearDND();
-            lastmode = mode;
-            mode = 0;
+        resultUntil = millis() + 3000;
+        break;
+
+        case 4:  // board solved
+        if (status != PROTO_DONE) {
+            dprintf("Error occured in solve");
+            displayTft(2, 0xF800, ST7735_WHITE, 45, 60, "NOT");
+            displayTft(2, 0xF800, ST7735_WHITE, 15, 90, "SOLVABLE");
+            resultUntil = millis() + 1500;
         }
-        if (mode == 4) {  // board solve mode
-            select = digitalRead(JOY_SEL);
-
-            dprintf("mode 4");
-            check = solve_board(board); // run board solving algorithm
-            dprintf("in mode 4 %d", check);
-            if (check != 0) {
-                Serial.println(-1);
-                dprintf("Error occured in solve");
-                displayTft(2, 0xF800, ST7735_WHITE, 45, 60, "NOT");
-                displayTft(2, 0xF800, ST7735_WHITE, 15, 90, "SOLVABLE");
-                delay(1500);
-                clearBoard();  // reset board state
-                clearDND();
-                lastmode = mode;
-                mode = 0;
-            }
-            else {
-                display_board();  //if solved, display resultant board
-            }
-            while (mode == 4) {
-                select = digitalRead(JOY_SEL);
-                if (select == 0) {
-                    // if click, go back to menu
-                    clearBoard();  // reset board for next game
-                    clearDND();  // reset hint dict
-                    lastmode = mode;
-                    mode = 0;
-                    break;
-                }
-            }
+        else {
+            display_board();  //if solved, display resultant board
         }
-        if (mode == 1) { // pre game
-            print_options();
-            dprintf("pre game");
-            select = digitalRead(JOY_SEL);
-            while (mode == 1){
-                // Scans for joystick input
-                scanDifficulty();
-
-                if (dif == 4){  //custom board mode lets you input your own board
-                    mode = 5;
-                    dif = 0;
-                }
-                else if (dif != 0) {
-                    gen_board(dif, board); // runs the board generating routine
-                    setDND(board);  // Sets Do Not Disturb cells, ie. hint cells
-                    mode = 5;
-                    dif = 0;
-                }
-                // selection and old_selection are used for highlighting
-                // in list mode.
-                old_selection = selection;
-                selection = selection + update;
-                if (selection == 0) {
-                    selection = 4;
-                } else if (selection == 5) {
-                    selection = 1;
-                }
-                if (update != 0) {
-                    update_options();
-                }
-            }
+        break;
+    }
+}
+
+void renderTask() {
+    /**
+    Task repainting whatever changed on the game screen since the last
+        frame, including the current selection position
+
+    @return Void
+    */
+    if (mode != 5 && !(mode == 4 && proto_status() == PROTO_DONE)) {
+        return;
+    }
+    if (update != 0) {  // updates the selection location
+        update_square();
+    }
+    scene_label_t label = SCENE_CURRENT;
+    if (setting) {
+        label = SCENE_SETTING;
+    }
+    else if (boardInvalid) {
+        label = SCENE_INVALID;
+    }
+    scene_set_status(row, col, label);
+    scene_flush(true);
+}
 
+void solveTask() {
+    /**
+    Task solving the board in the background, a slice at a time, to find
+        out whether it can still be completed
+
+    @return Void
+    */
+    if (solver.status != SOLVER_RUNNING) {
+        return;
+    }
+    while (sched_time_left()) {
+        if (board_solver_run(&solver, 16) != SOLVER_RUNNING) {
+            boardInvalid = (solver.status == SOLVER_UNSOLVABLE);
+            return;
         }
     }
+    sched_signal(TASK_SOLVE);  // not done yet, carry on next pass
+}
+
+void storageTask() {
+    /**
+    Task bringing up the SD card in the background once the menu is up.
+        This is one long run, but nothing else needs the processor yet.
+
+    @return Void
+    */
+    storageBegin();
+    bootReport();
+}
+
+void snapshotTask() {
+    /**
+    Task keeping the EEPROM snapshot up to date: saving the game in play
+        when it has changed, dropping it once the game is over, and writing
+        out the bytes that changed
+
+    @return Void
+    */
+    if (mode == 5 && snapDirty && millis() - snapLast >= SNAPSHOT_INTERVAL) {
+        saveGame();
+        snapDirty = false;
+        snapLast = millis();
+    }
+    else if (mode == 0 && snapSaved) {
+        snapshot_discard();
+        snapSaved = false;
+    }
+    snapshot_flush();
+}
+
+void reportTask() {
+    /**
+    Task reporting where the processor's time went, per task
+
+    @return Void
+    */
+    sched_report();
+}
+
+int main() {
+    setup();
+    sched_begin(tasks, sizeof(tasks) / sizeof(tasks[0]));
+    enterMode(resumed ? 5 : 0);
+    bootMark(BOOT_SCREEN);
+    sched_signal(TASK_STORAGE);
+    while (true) {
+        sched_run();
+    }
     Serial.end();
     return 0;
 }
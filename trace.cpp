@@ -0,0 +1,86 @@
+/*
+ * Timeline event tracer.
+ */
+
+#include <Arduino.h>
+#include <SD.h>
+
+#include "trace.h"
+#include "dprintf.h"
+
+static trace_event_t trace_ring[TRACE_EVENTS];
+static uint16_t trace_head = 0;   // next slot to write
+static uint16_t trace_count = 0;  // events in the ring
+static uint16_t trace_dropped = 0;
+
+// Set while the ring is being dumped, so that the dprintf and SD calls
+// doing it do not add to it.
+static bool trace_flushing = false;
+
+void trace_event(char phase, const char *name) {
+  if (trace_flushing) {
+    return;
+  }
+  trace_event_t *e = &trace_ring[trace_head];
+  e->us = micros();
+  e->name = name;
+  e->phase = phase;
+  trace_head = (trace_head + 1) % TRACE_EVENTS;
+  if (trace_count < TRACE_EVENTS) {
+    trace_count++;
+  } else if (trace_dropped < 0xFFFF) {
+    trace_dropped++;
+  }
+}
+
+/* The i-th oldest event in the ring. */
+static const trace_event_t *trace_at(uint16_t i) {
+  return &trace_ring[(trace_head + TRACE_EVENTS - trace_count + i) % TRACE_EVENTS];
+}
+
+static void trace_clear() {
+  trace_count = 0;
+  trace_dropped = 0;
+}
+
+void trace_flush_serial() {
+  trace_flushing = true;
+  dprintf("T sync %lu", (unsigned long) micros());
+  for (uint16_t i = 0; i < trace_count; i++) {
+    const trace_event_t *e = trace_at(i);
+    dprintf("T %lu %c %s", (unsigned long) e->us, e->phase, e->name);
+  }
+  if (trace_dropped > 0) {
+    dprintf("T dropped %u", trace_dropped);
+  }
+  trace_clear();
+  trace_flushing = false;
+}
+
+bool trace_flush_file(const char *path) {
+  trace_flushing = true;
+  File file = SD.open(path, FILE_WRITE);
+  if (!file) {
+    trace_flushing = false;
+    return false;
+  }
+
+  char line[48];
+  int n = snprintf(line, sizeof(line), "T sync %lu\n", (unsigned long) micros());
+  file.write((const uint8_t *) line, n);
+  for (uint16_t i = 0; i < trace_count; i++) {
+    const trace_event_t *e = trace_at(i);
+    n = snprintf(line, sizeof(line), "T %lu %c %s\n", (unsigned long) e->us,
+                 e->phase, e->name);
+    file.write((const uint8_t *) line, n < (int) sizeof(line) ? n : sizeof(line) - 1);
+  }
+  if (trace_dropped > 0) {
+    n = snprintf(line, sizeof(line), "T dropped %u\n", trace_dropped);
+    file.write((const uint8_t *) line, n);
+  }
+  file.close();
+
+  trace_clear();
+  trace_flushing = false;
+  return true;
+}
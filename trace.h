@@ -0,0 +1,80 @@
+/*
+ * Timeline event tracer.
+ *
+ * Where the profiler only keeps totals, the tracer keeps the order things
+ * happened in: each event is a micros() timestamp, a phase and a static
+ * name, written into a ring in SRAM that keeps the most recent
+ * TRACE_EVENTS events.  The ring is emptied by printing it over serial
+ * with dprintf, or by appending it to a file on the SD card, one event per
+ * line:
+ *
+ *   T sync <micros>            micros() when the dump started
+ *   T <micros> <phase> <name>
+ *   T dropped <count>          events lost since the last dump
+ *
+ * Phases are B and E for the two ends of a section (TRACE_SCOPE), I for a
+ * single moment, and b and e for the two ends of something that runs
+ * alongside the sections, like a server request.  server_files/trace2json.py
+ * turns the dumps into a Chrome trace, together with the server's log.
+ *
+ * Remove the TRACE_ENABLE define below to compile every event out.
+ */
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdint.h>
+
+#undef TRACE_ENABLE
+#define TRACE_ENABLE
+
+#ifdef __AVR__
+#define TRACE_EVENTS 64    // 7 bytes each
+#else
+#define TRACE_EVENTS 4096
+#endif
+
+#define TRACE_BEGIN 'B'
+#define TRACE_END 'E'
+#define TRACE_INSTANT 'I'
+#define TRACE_ASYNC_BEGIN 'b'
+#define TRACE_ASYNC_END 'e'
+
+typedef struct {
+  uint32_t us;       // micros() when it happened
+  const char *name;  // static string
+  char phase;
+} trace_event_t;
+
+/* Adds an event to the ring, overwriting the oldest when it is full. */
+void trace_event(char phase, const char *name);
+
+/* Prints the ring with dprintf and empties it.  Blocks until sent. */
+void trace_flush_serial();
+
+/* Appends the ring to a file on the SD card and empties it.  Returns false
+ * if the file could not be opened, in which case the ring is kept.
+ */
+bool trace_flush_file(const char *path);
+
+/* Records a section for its own lifetime; used by TRACE_SCOPE. */
+class TraceScope {
+public:
+  TraceScope(const char *name) : name(name) { trace_event(TRACE_BEGIN, name); }
+  ~TraceScope() { trace_event(TRACE_END, name); }
+private:
+  const char *name;
+};
+
+#define TRACE_CAT2(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT2(a, b)
+
+#ifdef TRACE_ENABLE
+#define TRACE_SCOPE(name) TraceScope TRACE_CAT(trace_scope_, __LINE__)(name)
+#define TRACE(phase, name) trace_event(phase, name)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE(phase, name)
+#endif
+
+#endif